@@ -11,12 +11,13 @@ using namespace std;
 void bidirectional_stream_copy( Socket& socket, string_view peer_name )
 {
   constexpr size_t buffer_size = 1048576;
+  constexpr size_t read_size = 65536;
 
   EventLoop eventloop {};
   FileDescriptor input { STDIN_FILENO };
   FileDescriptor output { STDOUT_FILENO };
-  ByteStream outbound { buffer_size };
-  ByteStream inbound { buffer_size };
+  ByteStream outbound { buffer_size, ByteStream::Storage::Chunked };
+  ByteStream inbound { buffer_size, ByteStream::Storage::Chunked };
   bool outbound_shutdown { false };
   bool inbound_shutdown { false };
 
@@ -30,10 +31,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     input,
     Direction::In,
     [&] {
-      string data;
-      data.resize( outbound.writer().available_capacity() );
-      input.read( data );
-      outbound.writer().push( move( data ) );
+      outbound.writer().commit( input.read( outbound.writer().reserve( read_size ) ) );
       if ( input.eof() ) {
         outbound.writer().close();
       }
@@ -55,9 +53,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::Out,
     [&] {
-      if ( outbound.reader().bytes_buffered() ) {
-        outbound.reader().pop( socket.write( outbound.reader().peek() ) );
-      }
+      outbound.reader().drain_to( socket );
       if ( outbound.reader().is_finished() ) {
         socket.shutdown( SHUT_WR );
         outbound_shutdown = true;
@@ -80,10 +76,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     socket,
     Direction::In,
     [&] {
-      string data;
-      data.resize( inbound.writer().available_capacity() );
-      socket.read( data );
-      inbound.writer().push( move( data ) );
+      inbound.writer().commit( socket.read( inbound.writer().reserve( read_size ) ) );
       if ( socket.eof() ) {
         inbound.writer().close();
       }
@@ -105,9 +98,7 @@ void bidirectional_stream_copy( Socket& socket, string_view peer_name )
     output,
     Direction::Out,
     [&] {
-      if ( inbound.reader().bytes_buffered() ) {
-        inbound.reader().pop( output.write( inbound.reader().peek() ) );
-      }
+      inbound.reader().drain_to( output );
       if ( inbound.reader().is_finished() ) {
         output.close();
         inbound_shutdown = true;
@@ -35,6 +35,11 @@ void show_usage( const char* argv0, const char* msg )
 
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
+       << "   -c <algo>       Congestion control: none, newreno, cubic or bbr  none\n\n"
+       << "   -S              Offer selective acknowledgments (SACK)          (off)\n"
+       << "   -W              Offer window scaling                            (off)\n"
+       << "   -m <mtu>        Size segments for <mtu>, negotiating the MSS    (none)\n\n"
+
        << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
 
        << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
@@ -96,6 +101,35 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
       c_fsm.rt_timeout = strtol( args[curr + 1], nullptr, 0 );
       curr += 2;
 
+    } else if ( strncmp( "-c", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -c requires one argument." );
+      using enum CongestionControl::Algorithm;
+      bool found = false;
+      for ( const auto algorithm : { None, NewReno, Cubic, BBR } ) {
+        if ( CongestionControl::make( algorithm, TCPConfig::MAX_PAYLOAD_SIZE )->name() == args[curr + 1] ) {
+          c_fsm.congestion_control = algorithm;
+          found = true;
+        }
+      }
+      if ( not found ) {
+        show_usage( args[0], "ERROR: unknown congestion control algorithm." );
+        exit( 1 );
+      }
+      curr += 2;
+
+    } else if ( strncmp( "-S", args[curr], 3 ) == 0 ) {
+      c_fsm.sack = true;
+      curr += 1;
+
+    } else if ( strncmp( "-m", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -m requires one argument." );
+      c_fsm.mtu = strtol( args[curr + 1], nullptr, 0 );
+      curr += 2;
+
+    } else if ( strncmp( "-W", args[curr], 3 ) == 0 ) {
+      c_fsm.window_scaling = true;
+      curr += 1;
+
     } else if ( strncmp( "-d", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -t requires one argument." );
       tundev = args[curr + 1];
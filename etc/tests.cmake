@@ -23,6 +23,11 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_chunked)
+ttest(byte_stream_spsc)
+ttest(byte_stream_drain)
+ttest(byte_stream_spill)
+ttest(chunk_pool)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -45,6 +50,8 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_window_scale)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,6 +60,12 @@ ttest(send_ack)
 ttest(send_close)
 ttest(send_retx)
 ttest(send_extra)
+ttest(send_congestion)
+ttest(send_rto)
+ttest(send_fast_retx)
+ttest(send_sack)
+ttest(send_window_scale)
+ttest(send_mss)
 
 ttest(net_interface)
 
@@ -94,3 +107,5 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(wrapping_integers_speed_test)
+stest(tcp_sender_speed_test)
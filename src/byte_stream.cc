@@ -1,24 +1,140 @@
--#include "byte_stream.hh"
+#include "byte_stream.hh"
+#include "chunk_pool.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <sys/mman.h>
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ),
-    error_(false),
-    buffer_(),
-    pushed_(0),
-    popped_(0),
-    closed_(false)
-{}
+namespace {
+// Pushes at most this long are appended to the last chunk rather than queued as their own chunk.
+constexpr uint64_t kCoalesceLimit = 256;
+
+// peek_iov() returns at most this many views (well under IOV_MAX).
+constexpr size_t kMaxIovecs = 64;
+} // namespace
+
+ByteStream::ByteStream( uint64_t capacity, Storage storage )
+  : capacity_( capacity )
+  , storage_mode_( storage )
+  , storage_( storage == Storage::Ring ? bit_ceil( max<uint64_t>( capacity, 1 ) ) : 0 )
+  , mask_( storage == Storage::Chunked ? 0 : bit_ceil( max<uint64_t>( capacity, 1 ) ) - 1 )
+{
+  if ( storage == Storage::Spill ) {
+    spill_.emplace( ring_size() );
+  }
+}
 
+void ByteStream::spill_pushed( uint64_t old_pushed )
+{
+  // A mapping of only a couple of extents is small enough to leave to the kernel.
+  if ( not spill_.has_value() or ring_size() <= 2 * spill_extent_ ) {
+    return;
+  }
 
+  // Page out each extent the tail has just finished, unless the head is still reading it.
+  const uint64_t head_extent = popped_ / spill_extent_;
+  for ( uint64_t extent = old_pushed / spill_extent_; extent < pushed_ / spill_extent_; ++extent ) {
+    if ( extent != head_extent ) {
+      spill_->advise( ( extent * spill_extent_ ) & mask_, spill_extent_, MADV_PAGEOUT );
+    }
+  }
+}
 
-void Writer::push(std::string data)
+void ByteStream::spill_popped( uint64_t old_popped )
 {
-  size_t n = std::min<uint64_t>(data.size(), available_capacity());
-  for (size_t i = 0; i < n; i++) {
-    buffer_.push_back(data[i]);
+  if ( not spill_.has_value() or ring_size() <= 2 * spill_extent_
+       or old_popped / spill_extent_ == popped_ / spill_extent_ ) {
+    return;
+  }
+
+  // The head has entered a new extent: prefetch the one after it.
+  const uint64_t next_extent_start = ( popped_ / spill_extent_ + 1 ) * spill_extent_;
+  if ( next_extent_start < pushed_ ) {
+    spill_->advise( next_extent_start & mask_, min( spill_extent_, pushed_ - next_extent_start ), MADV_WILLNEED );
+  }
+}
+
+void Writer::push( string data )
+{
+  reserved_ = 0;
+  const uint64_t len = min<uint64_t>( data.size(), available_capacity() );
+  if ( len == 0 ) {
+    return;
+  }
+
+  if ( storage_mode_ == Storage::Chunked ) {
+    pushed_ += len;
+    if ( len <= kCoalesceLimit and not chunks_.empty() ) {
+      chunks_.back().append( data, 0, len );
+      return;
+    }
+    if ( len < data.capacity() / 4 and data.capacity() > ChunkPool::kSizeClasses.front() ) {
+      // don't tie up a mostly-empty allocation (e.g. a pooled read buffer holding one segment) in the queue
+      chunks_.push_back( ChunkPool::acquire( len ) );
+      chunks_.back().assign( data, 0, len );
+      ChunkPool::release( move( data ) );
+      return;
+    }
+    data.resize( len ); // only trims when the push exceeds the available capacity
+    chunks_.push_back( move( data ) );
+    return;
+  }
+
+  const uint64_t start = pushed_ & mask_;
+  const uint64_t first_part = min<uint64_t>( len, ring_size() - start );
+
+  memcpy( ring() + start, data.data(), first_part );
+  memcpy( ring(), data.data() + first_part, len - first_part ); // wrap around to the front
+  pushed_ += len;
+  spill_pushed( pushed_ - len );
+}
+
+span<char> Writer::reserve( uint64_t max_len )
+{
+  reserved_ = min( max_len, available_capacity() );
+
+  if ( storage_mode_ == Storage::Chunked ) {
+    if ( staging_.capacity() < reserved_ ) {
+      staging_ = ChunkPool::acquire( reserved_ );
+    }
+    staging_.resize( reserved_ );
+    return { staging_.data(), staging_.size() };
+  }
+
+  // Only the contiguous run up to the end of the storage can be handed out.
+  const uint64_t start = pushed_ & mask_;
+  reserved_ = min<uint64_t>( reserved_, ring_size() - start );
+  return { ring() + start, reserved_ };
+}
+
+void Writer::commit( uint64_t len )
+{
+  len = min( len, reserved_ );
+  reserved_ = 0;
+  if ( len == 0 ) {
+    return;
+  }
+
+  pushed_ += len;
+  if ( storage_mode_ != Storage::Chunked ) {
+    spill_pushed( pushed_ - len );
+    return; // the bytes are already in place
+  }
+
+  if ( len <= kCoalesceLimit and not chunks_.empty() ) {
+    chunks_.back().append( staging_, 0, len ); // keep the staging buffer for the next reservation
+  } else if ( len < staging_.size() / 4 ) {
+    // don't tie up a mostly-empty allocation in the queue
+    chunks_.push_back( ChunkPool::acquire( len ) );
+    chunks_.back().assign( staging_, 0, len );
+  } else {
+    staging_.resize( len );
+    chunks_.push_back( move( staging_ ) );
+    staging_ = string {};
   }
-  pushed_ += n;
 }
 
 void Writer::close()
@@ -33,41 +149,88 @@ bool Writer::is_closed() const
 
 uint64_t Writer::available_capacity() const
 {
-  return capacity_ - buffer_.size();
+  return capacity_ - ( pushed_ - popped_ );
 }
 
 uint64_t Writer::bytes_pushed() const
 {
-  return pushed_; // Your code here.
+  return pushed_;
 }
 
+// Returns the buffered bytes up to the end of the storage (the rest, if any, is visible after a pop).
 string_view Reader::peek() const
 {
-  if (buffer_.empty()) return {};
-  return string_view(buffer_.data(), buffer_.size());
+  if ( storage_mode_ == Storage::Chunked ) {
+    if ( chunks_.empty() ) {
+      return {};
+    }
+    return string_view { chunks_.front() }.substr( chunk_offset_ );
+  }
+
+  const uint64_t start = popped_ & mask_;
+  return { ring() + start, min<uint64_t>( bytes_buffered(), ring_size() - start ) };
 }
 
+vector<string_view> Reader::peek_iov( uint64_t max_len ) const
+{
+  vector<string_view> views;
+  max_len = min( max_len, bytes_buffered() );
+
+  if ( storage_mode_ == Storage::Chunked ) {
+    uint64_t offset = chunk_offset_;
+    for ( auto it = chunks_.begin(); max_len > 0 and it != chunks_.end() and views.size() < kMaxIovecs; ++it ) {
+      const string_view view = string_view { *it }.substr( offset, max_len );
+      views.push_back( view );
+      max_len -= view.size();
+      offset = 0;
+    }
+    return views;
+  }
 
-void Reader::pop(uint64_t len)
+  // The ring holds at most two contiguous runs: up to the end of the storage, then from its front.
+  const uint64_t start = popped_ & mask_;
+  const uint64_t first_part = min<uint64_t>( max_len, ring_size() - start );
+  if ( first_part > 0 ) {
+    views.emplace_back( ring() + start, first_part );
+  }
+  if ( max_len > first_part ) {
+    views.emplace_back( ring(), max_len - first_part );
+  }
+  return views;
+}
+
+void Reader::pop( uint64_t len )
 {
-  size_t n = min<uint64_t>(len, buffer_.size());
-  buffer_.erase(0, n);
-  popped_ += n;
+  len = min( len, bytes_buffered() );
+  popped_ += len;
+  spill_popped( popped_ - len );
+
+  if ( storage_mode_ == Storage::Chunked ) {
+    while ( len > 0 ) {
+      const uint64_t front_remaining = chunks_.front().size() - chunk_offset_;
+      if ( len < front_remaining ) {
+        chunk_offset_ += len;
+        return;
+      }
+      len -= front_remaining;
+      ChunkPool::release( move( chunks_.front() ) );
+      chunks_.pop_front();
+      chunk_offset_ = 0;
+    }
+  }
 }
 
 bool Reader::is_finished() const
 {
-  return closed_ && buffer_.empty();
+  return closed_ and bytes_buffered() == 0;
 }
 
-
 uint64_t Reader::bytes_buffered() const
 {
-  return buffer_.size();
+  return pushed_ - popped_;
 }
 
-
 uint64_t Reader::bytes_popped() const
 {
   return popped_;
-}
\ No newline at end of file
+}
@@ -1,17 +1,31 @@
 #pragma once
 
+#include "temp_file_mapping.hh"
+
 #include <cstdint>
+#include <deque>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
-#include <deque>
+#include <vector>
 
 class Reader;
 class Writer;
+class FileDescriptor;
 
 class ByteStream
 {
 public:
-  explicit ByteStream( uint64_t capacity );
+  // How the ByteStream holds buffered bytes
+  enum class Storage : uint8_t
+  {
+    Ring,    // copied into a circular buffer allocated once at construction
+    Chunked, // pushed strings are adopted (moved) into a queue of chunks, so a push copies nothing
+    Spill,   // like Ring, but the circular buffer is a mapped temporary file, so capacity can exceed RAM
+  };
+
+  explicit ByteStream( uint64_t capacity, Storage storage = Storage::Ring );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -19,17 +33,48 @@ public:
   Writer& writer();
   const Writer& writer() const;
 
+  Storage storage() const { return storage_mode_; }
+
   void set_error() { error_ = true; };       // Signal that the stream suffered an error.
   bool has_error() const { return error_; }; // Has the stream had an error?
 
 protected:
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
   uint64_t capacity_;
+  Storage storage_mode_;
   bool error_ {};
-  std::string buffer_;
-  uint64_t pushed_ {0};
-  uint64_t popped_ {0};
-  bool closed_ {false};
+
+  // Storage::Ring: circular storage, allocated once. Its size is a power of two no smaller than the capacity,
+  // so a cumulative byte count maps to a slot with a mask. The buffered bytes are [popped_, pushed_).
+  std::vector<char> storage_;
+  uint64_t mask_;
+
+  // Storage::Spill: the same circular storage, in a mapped temporary file. Only the extents around the
+  // head and tail need to stay in memory; completed extents in between are handed back to the kernel
+  // to write out, and the next extent to be read is prefetched.
+  std::optional<TempFileMapping> spill_ {};
+  static constexpr uint64_t kSpillExtent = uint64_t { 1 } << 26;
+  uint64_t spill_extent_ = kSpillExtent; // a power of two (tests shrink it to exercise the advice cheaply)
+
+  char* ring() { return spill_.has_value() ? spill_->data() : storage_.data(); }
+  const char* ring() const { return spill_.has_value() ? spill_->data() : storage_.data(); }
+  uint64_t ring_size() const { return mask_ + 1; }
+  void spill_pushed( uint64_t old_pushed ); // advise the kernel after the tail moves
+  void spill_popped( uint64_t old_popped ); // advise the kernel after the head moves
+
+  // Storage::Chunked: adopted strings, oldest first. The first `chunk_offset_` bytes of the front chunk
+  // have already been popped.
+  std::deque<std::string> chunks_ {};
+  uint64_t chunk_offset_ {};
+
+  // Space handed out by Writer::reserve() and not yet committed. For Storage::Chunked, the reserved
+  // bytes live in `staging_` until commit() adopts them as a chunk.
+  uint64_t reserved_ {};
+  std::string staging_ {};
+
+  uint64_t pushed_ {};
+  uint64_t popped_ {};
+  bool closed_ {};
 };
 
 class Writer : public ByteStream
@@ -38,6 +83,13 @@ public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
+  // Two-step push that lets the caller write directly into the stream's memory: reserve() returns writable
+  // space for up to `max_len` bytes (possibly fewer, and empty if the stream is full), and commit() appends
+  // the first `len` bytes of that space to the stream. Any push() or reserve() cancels an uncommitted
+  // reservation.
+  std::span<char> reserve( uint64_t max_len );
+  void commit( uint64_t len );
+
   bool is_closed() const;              // Has the stream been closed?
   uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
@@ -49,6 +101,13 @@ public:
   std::string_view peek() const; // Peek at the next bytes in the buffer
   void pop( uint64_t len );      // Remove `len` bytes from the buffer
 
+  // Peek at up to `max_len` buffered bytes as a list of contiguous views, in order (suitable for writev)
+  std::vector<std::string_view> peek_iov( uint64_t max_len = UINT64_MAX ) const;
+
+  // Write up to `max_len` buffered bytes to `fd` in one writev, and pop exactly the bytes that were written.
+  // Returns the number of bytes moved.
+  uint64_t drain_to( FileDescriptor& fd, uint64_t max_len = UINT64_MAX );
+
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
   uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
   uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
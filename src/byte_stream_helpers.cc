@@ -1,5 +1,7 @@
 #include "byte_stream.hh"
+#include "file_descriptor.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
 
@@ -12,6 +14,7 @@ using namespace std;
 void read( Reader& reader, uint64_t max_len, string& out )
 {
   out.clear();
+  out.reserve( min( max_len, reader.bytes_buffered() ) );
 
   while ( reader.bytes_buffered() and out.size() < max_len ) {
     auto view = reader.peek();
@@ -26,6 +29,17 @@ void read( Reader& reader, uint64_t max_len, string& out )
   }
 }
 
+uint64_t Reader::drain_to( FileDescriptor& fd, uint64_t max_len )
+{
+  if ( bytes_buffered() == 0 or max_len == 0 ) {
+    return 0;
+  }
+
+  const uint64_t bytes_written = fd.write( peek_iov( max_len ) );
+  pop( bytes_written );
+  return bytes_written;
+}
+
 Reader& ByteStream::reader()
 {
   static_assert( sizeof( Reader ) == sizeof( ByteStream ),
@@ -0,0 +1,258 @@
+#include "congestion_control.hh"
+#include "trace.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// ProbeBW spends one min-RTT probing for more bandwidth, one draining what that queued, then six cruising.
+constexpr array<double, 8> PROBE_BW_GAINS { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+
+} // namespace
+
+unique_ptr<CongestionControl> CongestionControl::make( Algorithm algorithm, uint64_t mss )
+{
+  switch ( algorithm ) {
+    case Algorithm::None:
+      return make_unique<NoCongestionControl>();
+    case Algorithm::NewReno:
+      return make_unique<NewReno>( mss );
+    case Algorithm::Cubic:
+      return make_unique<Cubic>( mss );
+    case Algorithm::BBR:
+      return make_unique<BBR>( mss );
+  }
+  throw runtime_error( "CongestionControl::make: unknown algorithm" );
+}
+
+/* ---------------- NewReno ---------------- */
+
+NewReno::NewReno( uint64_t mss ) : mss_( mss ), cwnd_( INITIAL_WINDOW_SEGMENTS * mss ) {}
+
+void NewReno::on_ack( const AckSample& sample )
+{
+  // The window was set when the loss was detected, and holds until it has been repaired.
+  if ( sample.in_recovery ) {
+    return;
+  }
+
+  if ( cwnd_ < ssthresh_ ) {
+    // Slow start, counting acked bytes with a limit of two segments per ack (RFC 3465).
+    cwnd_ += min( sample.bytes_acked, 2 * mss_ );
+    return;
+  }
+
+  // Congestion avoidance: one segment per window's worth of acked bytes.
+  acked_in_window_ += sample.bytes_acked;
+  if ( acked_in_window_ >= cwnd_ ) {
+    acked_in_window_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void NewReno::on_loss( uint64_t /*now_ms*/, uint64_t bytes_in_flight )
+{
+  ssthresh_ = max( bytes_in_flight / 2, 2 * mss_ );
+  cwnd_ = ssthresh_;
+  acked_in_window_ = 0;
+  trace<TraceLevel::Info>( "cc", "newreno: loss, cwnd {}", cwnd_ );
+}
+
+void NewReno::on_rto( uint64_t /*now_ms*/, uint64_t bytes_in_flight )
+{
+  ssthresh_ = max( bytes_in_flight / 2, 2 * mss_ );
+  cwnd_ = mss_;
+  acked_in_window_ = 0;
+  trace<TraceLevel::Info>( "cc", "newreno: timeout, ssthresh {}", ssthresh_ );
+}
+
+/* ---------------- Cubic ---------------- */
+
+Cubic::Cubic( uint64_t mss )
+  : mss_( static_cast<double>( mss ) ), cwnd_( static_cast<double>( INITIAL_WINDOW_SEGMENTS * mss ) )
+{}
+
+void Cubic::on_ack( const AckSample& sample )
+{
+  const auto acked = static_cast<double>( sample.bytes_acked );
+  if ( sample.rtt_ms.has_value() ) {
+    rtt_ms_ = *sample.rtt_ms;
+  }
+  if ( sample.in_recovery ) {
+    return;
+  }
+
+  if ( cwnd_ < ssthresh_ ) {
+    cwnd_ += min( acked, 2 * mss_ );
+    return;
+  }
+
+  if ( not epoch_start_ms_.has_value() ) {
+    epoch_start_ms_ = sample.now_ms;
+    if ( cwnd_ < w_max_ ) {
+      k_seconds_ = cbrt( ( w_max_ - cwnd_ ) / mss_ / C );
+    } else {
+      k_seconds_ = 0;
+      w_max_ = cwnd_;
+    }
+    w_est_ = cwnd_;
+  }
+
+  // Where the cubic will be one RTT from now (in bytes), no more than half again the current window.
+  const double t = static_cast<double>( sample.now_ms - *epoch_start_ms_ + rtt_ms_ ) / 1000.0 - k_seconds_;
+  const double target = clamp( ( C * t * t * t ) * mss_ + w_max_, cwnd_, 1.5 * cwnd_ );
+
+  // Reno's average growth, scaled to match its throughput given CUBIC's gentler reduction
+  w_est_ += 3 * ( 1 - BETA ) / ( 1 + BETA ) * acked / cwnd_ * mss_;
+
+  if ( target < w_est_ ) {
+    cwnd_ = w_est_;
+  } else {
+    cwnd_ += ( target - cwnd_ ) / cwnd_ * acked;
+  }
+}
+
+void Cubic::reduce()
+{
+  // Fast convergence: if the window didn't regain its previous peak, leave room for newer flows.
+  w_max_ = cwnd_ < w_max_ ? cwnd_ * ( 1 + BETA ) / 2 : cwnd_;
+  ssthresh_ = max( cwnd_ * BETA, 2 * mss_ );
+  epoch_start_ms_.reset();
+}
+
+void Cubic::on_loss( uint64_t /*now_ms*/, uint64_t /*bytes_in_flight*/ )
+{
+  reduce();
+  cwnd_ = ssthresh_;
+  trace<TraceLevel::Info>( "cc", "cubic: loss, cwnd {}", cwnd() );
+}
+
+void Cubic::on_rto( uint64_t /*now_ms*/, uint64_t /*bytes_in_flight*/ )
+{
+  reduce();
+  cwnd_ = mss_;
+  trace<TraceLevel::Info>( "cc", "cubic: timeout, ssthresh {}", ssthresh() );
+}
+
+/* ---------------- BBR ---------------- */
+
+BBR::BBR( uint64_t mss ) : mss_( mss ), cwnd_( INITIAL_WINDOW_SEGMENTS * mss ) {}
+
+uint64_t BBR::bottleneck_bandwidth() const
+{
+  return *max_element( bw_by_round_.begin(), bw_by_round_.end() );
+}
+
+uint64_t BBR::pacing_rate() const
+{
+  return static_cast<uint64_t>( pacing_gain_ * static_cast<double>( bottleneck_bandwidth() ) );
+}
+
+uint64_t BBR::bdp( double gain ) const
+{
+  const uint64_t bw = bottleneck_bandwidth();
+  if ( bw == 0 or not min_rtt_ms_.has_value() ) {
+    return INITIAL_WINDOW_SEGMENTS * mss_;
+  }
+  // The clock only has millisecond resolution, so a faster path is treated as a 1 ms one.
+  return static_cast<uint64_t>( gain * static_cast<double>( bw * max<uint64_t>( *min_rtt_ms_, 1 ) ) / 1000 );
+}
+
+void BBR::update_model( const AckSample& sample )
+{
+  // A round trip ends when a segment sent after the previous one ended is acknowledged.
+  round_start_ = false;
+  if ( sample.prior_delivered.has_value() and *sample.prior_delivered >= next_round_delivered_ ) {
+    next_round_delivered_ = sample.delivered;
+    ++round_;
+    round_start_ = true;
+    bw_by_round_.at( round_ % BW_WINDOW_ROUNDS ) = 0;
+  }
+
+  if ( not sample.rtt_ms.has_value() ) {
+    return;
+  }
+
+  if ( sample.prior_delivered.has_value() ) {
+    const uint64_t interval_ms = max<uint64_t>( *sample.rtt_ms, 1 );
+    const uint64_t rate = ( sample.delivered - *sample.prior_delivered ) * 1000 / interval_ms;
+    auto& slot = bw_by_round_.at( round_ % BW_WINDOW_ROUNDS );
+    slot = max( slot, rate );
+  }
+
+  if ( not min_rtt_ms_.has_value() or *sample.rtt_ms <= *min_rtt_ms_
+       or sample.now_ms - min_rtt_stamp_ms_ > MIN_RTT_WINDOW_MS ) {
+    min_rtt_ms_ = *sample.rtt_ms;
+    min_rtt_stamp_ms_ = sample.now_ms;
+  }
+}
+
+void BBR::update_mode( const AckSample& sample )
+{
+  if ( not full_bw_reached_ and round_start_ ) {
+    const uint64_t bw = bottleneck_bandwidth();
+    if ( bw >= full_bw_ + full_bw_ / 4 ) {
+      full_bw_ = bw;
+      full_bw_rounds_ = 0;
+    } else if ( ++full_bw_rounds_ >= 3 ) {
+      full_bw_reached_ = true;
+    }
+  }
+
+  switch ( mode_ ) {
+    case Mode::Startup:
+      if ( full_bw_reached_ ) {
+        mode_ = Mode::Drain;
+        pacing_gain_ = 1 / HIGH_GAIN;
+        trace<TraceLevel::Info>( "cc", "bbr: drain, bandwidth {} B/s", bottleneck_bandwidth() );
+      }
+      break;
+
+    case Mode::Drain:
+      if ( sample.bytes_in_flight <= bdp( 1 ) ) {
+        mode_ = Mode::ProbeBW;
+        cwnd_gain_ = 2;
+        cycle_index_ = 0;
+        cycle_stamp_ms_ = sample.now_ms;
+        pacing_gain_ = PROBE_BW_GAINS.at( cycle_index_ );
+        trace<TraceLevel::Info>( "cc", "bbr: probe_bw, bdp {}", bdp( 1 ) );
+      }
+      break;
+
+    case Mode::ProbeBW:
+      if ( sample.now_ms - cycle_stamp_ms_ >= max<uint64_t>( min_rtt_ms_.value_or( 0 ), 1 ) ) {
+        cycle_index_ = ( cycle_index_ + 1 ) % PROBE_BW_GAINS.size();
+        cycle_stamp_ms_ = sample.now_ms;
+        pacing_gain_ = PROBE_BW_GAINS.at( cycle_index_ );
+      }
+      break;
+  }
+}
+
+void BBR::on_ack( const AckSample& sample )
+{
+  update_model( sample );
+  update_mode( sample );
+
+  // Move toward the target window; before the pipe is known to be full, only ever grow.
+  const uint64_t target = bdp( cwnd_gain_ );
+  if ( full_bw_reached_ ) {
+    cwnd_ = min( cwnd_ + sample.bytes_acked, target );
+  } else if ( cwnd_ < target or sample.delivered < INITIAL_WINDOW_SEGMENTS * mss_ ) {
+    cwnd_ += sample.bytes_acked;
+  }
+  cwnd_ = max( cwnd_, MIN_CWND_SEGMENTS * mss_ );
+}
+
+// The model is driven by delivery rate and RTT, not loss, so a loss alone changes nothing.
+void BBR::on_loss( uint64_t /*now_ms*/, uint64_t /*bytes_in_flight*/ ) {}
+
+void BBR::on_rto( uint64_t /*now_ms*/, uint64_t /*bytes_in_flight*/ )
+{
+  cwnd_ = MIN_CWND_SEGMENTS * mss_;
+  trace<TraceLevel::Info>( "cc", "bbr: timeout" );
+}
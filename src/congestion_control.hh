@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+// What the sender learned from one acknowledgment that advanced the window.
+struct AckSample
+{
+  uint64_t now_ms {};          // the sender's clock when the ack arrived
+  uint64_t bytes_acked {};     // sequence numbers newly acknowledged
+  uint64_t bytes_in_flight {}; // sequence numbers still outstanding afterwards
+  uint64_t delivered {};       // sequence numbers acknowledged since the connection began
+  bool in_recovery {};         // the sender was repairing a loss (reported by on_loss) until at least this ack
+
+  // Taken from the newest segment this ack covered, unless any segment it covered was retransmitted (Karn's
+  // rule: the ack may have waited for the retransmission, so neither the trip time nor the rate is known):
+  std::optional<uint64_t> rtt_ms {};          // how long it took to be acknowledged
+  std::optional<uint64_t> prior_delivered {}; // `delivered` when it was sent
+};
+
+// A congestion controller decides how many sequence numbers the sender may have in flight (the congestion
+// window), and optionally how fast to release them (the pacing rate). The sender sends no more than
+// min(cwnd, receiver's window), and reports acknowledgments and losses back.
+class CongestionControl
+{
+public:
+  enum class Algorithm : uint8_t
+  {
+    None,    // no congestion window: limited only by the receiver's window
+    NewReno, // RFC 5681 / RFC 6582
+    Cubic,   // RFC 9438
+    BBR,     // a simplified model-based controller after BBRv1
+  };
+
+  static constexpr uint64_t INITIAL_WINDOW_SEGMENTS = 10; // RFC 6928
+
+  // Make a controller for a connection that sends segments of up to `mss` bytes.
+  static std::unique_ptr<CongestionControl> make( Algorithm algorithm, uint64_t mss );
+
+  virtual ~CongestionControl() = default;
+
+  virtual std::string_view name() const = 0;
+
+  // The window advanced.
+  virtual void on_ack( const AckSample& sample ) = 0;
+
+  // Loss was detected without a timeout (e.g. by duplicate acks), with `bytes_in_flight` outstanding.
+  virtual void on_loss( uint64_t now_ms, uint64_t bytes_in_flight ) = 0;
+
+  // The retransmission timer expired with `bytes_in_flight` outstanding.
+  virtual void on_rto( uint64_t now_ms, uint64_t bytes_in_flight ) = 0;
+
+  // Maximum sequence numbers in flight.
+  virtual uint64_t cwnd() const = 0;
+
+  // Bytes per second to release segments at, or 0 to send as soon as the window allows.
+  virtual uint64_t pacing_rate() const { return 0; }
+};
+
+class NoCongestionControl : public CongestionControl
+{
+public:
+  std::string_view name() const override { return "none"; }
+  void on_ack( const AckSample& /*sample*/ ) override {}
+  void on_loss( uint64_t /*now_ms*/, uint64_t /*bytes_in_flight*/ ) override {}
+  void on_rto( uint64_t /*now_ms*/, uint64_t /*bytes_in_flight*/ ) override {}
+  uint64_t cwnd() const override { return std::numeric_limits<uint64_t>::max(); }
+};
+
+// Slow start, then one segment per window of acks; halve the window on loss, collapse it on timeout.
+class NewReno : public CongestionControl
+{
+public:
+  explicit NewReno( uint64_t mss );
+
+  std::string_view name() const override { return "newreno"; }
+  void on_ack( const AckSample& sample ) override;
+  void on_loss( uint64_t now_ms, uint64_t bytes_in_flight ) override;
+  void on_rto( uint64_t now_ms, uint64_t bytes_in_flight ) override;
+  uint64_t cwnd() const override { return cwnd_; }
+  uint64_t ssthresh() const { return ssthresh_; }
+
+private:
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ = std::numeric_limits<uint64_t>::max();
+  uint64_t acked_in_window_ {}; // bytes acked toward the next congestion-avoidance increase
+};
+
+// Grow the window along a cubic in the time since the last loss, centred on the window at that loss, but never
+// more slowly than Reno would.
+class Cubic : public CongestionControl
+{
+public:
+  static constexpr double C = 0.4;
+  static constexpr double BETA = 0.7;
+
+  explicit Cubic( uint64_t mss );
+
+  std::string_view name() const override { return "cubic"; }
+  void on_ack( const AckSample& sample ) override;
+  void on_loss( uint64_t now_ms, uint64_t bytes_in_flight ) override;
+  void on_rto( uint64_t now_ms, uint64_t bytes_in_flight ) override;
+  uint64_t cwnd() const override { return static_cast<uint64_t>( cwnd_ ); }
+  uint64_t ssthresh() const { return static_cast<uint64_t>( ssthresh_ ); }
+
+private:
+  void reduce();
+
+  double mss_;
+  double cwnd_;
+  double ssthresh_ = std::numeric_limits<double>::infinity();
+
+  // State of the current congestion-avoidance epoch (all in bytes, except the times)
+  std::optional<uint64_t> epoch_start_ms_ {};
+  double w_max_ {};     // window just before the last reduction (less, after repeated reductions)
+  double k_seconds_ {}; // time for the cubic to climb back to w_max_
+  double w_est_ {};     // what Reno would have reached over the epoch
+  uint64_t rtt_ms_ {};  // latest round-trip sample
+};
+
+// Estimate the path's bottleneck bandwidth (max recent delivery rate) and propagation delay (min RTT), pace at
+// a multiple of the bandwidth and cap in-flight data at a multiple of their product. Startup doubles the rate
+// each round until bandwidth stops growing, Drain empties the queue that built, and ProbeBW cycles the pacing
+// gain around 1. Unlike BBRv1 there is no ProbeRTT phase; the min RTT simply expires after ten seconds.
+class BBR : public CongestionControl
+{
+public:
+  enum class Mode : uint8_t
+  {
+    Startup,
+    Drain,
+    ProbeBW,
+  };
+
+  static constexpr double HIGH_GAIN = 2.885; // 2/ln(2)
+  static constexpr uint64_t MIN_CWND_SEGMENTS = 4;
+  static constexpr uint64_t BW_WINDOW_ROUNDS = 10;
+  static constexpr uint64_t MIN_RTT_WINDOW_MS = 10'000;
+
+  explicit BBR( uint64_t mss );
+
+  std::string_view name() const override { return "bbr"; }
+  void on_ack( const AckSample& sample ) override;
+  void on_loss( uint64_t now_ms, uint64_t bytes_in_flight ) override;
+  void on_rto( uint64_t now_ms, uint64_t bytes_in_flight ) override;
+  uint64_t cwnd() const override { return cwnd_; }
+  uint64_t pacing_rate() const override;
+
+  Mode mode() const { return mode_; }
+  uint64_t bottleneck_bandwidth() const; // bytes per second
+  std::optional<uint64_t> min_rtt_ms() const { return min_rtt_ms_; }
+
+private:
+  void update_model( const AckSample& sample );
+  void update_mode( const AckSample& sample );
+  uint64_t bdp( double gain ) const;
+
+  uint64_t mss_;
+  uint64_t cwnd_;
+  Mode mode_ = Mode::Startup;
+
+  // Delivery-rate samples: the largest in each of the last BW_WINDOW_ROUNDS rounds
+  std::array<uint64_t, BW_WINDOW_ROUNDS> bw_by_round_ {};
+  uint64_t round_ {};
+  uint64_t next_round_delivered_ {};
+  bool round_start_ {};
+
+  std::optional<uint64_t> min_rtt_ms_ {};
+  uint64_t min_rtt_stamp_ms_ {};
+
+  // Startup ends once bandwidth grows less than 25% for three rounds
+  uint64_t full_bw_ {};
+  uint64_t full_bw_rounds_ {};
+  bool full_bw_reached_ {};
+
+  double pacing_gain_ = HIGH_GAIN;
+  double cwnd_gain_ = HIGH_GAIN;
+  size_t cycle_index_ {};
+  uint64_t cycle_stamp_ms_ {};
+};
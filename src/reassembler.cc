@@ -1,180 +1,307 @@
 #include "reassembler.hh"
+#include "chunk_pool.hh"
+#include "trace.hh"
 #include <algorithm>
-#include <iostream>
-#include <vector>
+#include <bit>
+#include <cstring>
 
 using namespace std;
 
-Reassembler::Reassembler( ByteStream&& output )
-  : output_( move( output ) ), first_unassembled_index_( 0 ), eof_seen_( false ), eof_index_( 0 ), buffer_()
+namespace {
+
+// Call op( word, mask ) for each word of a bitmap covering bit positions [first, last), where mask selects
+// the positions within that word.
+template<typename Op>
+void for_each_word( uint64_t first, uint64_t last, Op&& op )
 {
-  cout << "[Reassembler starting up]" << endl;
+  while ( first < last ) {
+    const uint64_t offset = first % 64;
+    const uint64_t count = min<uint64_t>( 64 - offset, last - first );
+    const uint64_t mask = ( count == 64 ? ~uint64_t { 0 } : ( uint64_t { 1 } << count ) - 1 ) << offset;
+    op( first / 64, mask );
+    first += count;
+  }
 }
 
-void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
+// Same, for the absolute indices [first, last) of a circular bitmap with the given size mask.
+template<typename Op>
+void for_each_ring_word( uint64_t first, uint64_t last, uint64_t ring_mask, Op&& op )
 {
-  // original start and end of this incoming chunk
-  uint64_t orig_first = first_index;
-  uint64_t orig_end = first_index + data.size();
+  const uint64_t start = first & ring_mask;
+  const uint64_t first_part = min( last - first, ring_mask + 1 - start );
+  for_each_word( start, start + first_part, op );
+  for_each_word( 0, last - first - first_part, op ); // wrap around to the front
+}
 
-  // if this is the last substring, remember where the stream ends
-  if ( is_last_substring ) {
-    eof_seen_ = true;
-    eof_index_ = orig_end;
-  }
+} // namespace
 
-  // ignore empty input unless it’s the actual EOF marker
-  if ( data.empty() && !is_last_substring ) {
-    cout << "insert() called with empty data... (lol useless)" << endl;
-    return;
-  }
+Reassembler::Reassembler( ByteStream&& output, uint64_t max_intervals )
+  : output_( move( output ) )
+  , mask_( bit_ceil( max<uint64_t>( output_.writer().available_capacity() + output_.reader().bytes_buffered(), 1 ) )
+           - 1 )
+  , window_( output_.storage() == ByteStream::Storage::Spill ? nullptr
+                                                              : make_unique_for_overwrite<char[]>( mask_ + 1 ) )
+  , present_( output_.storage() == ByteStream::Storage::Spill ? 0 : ( mask_ + 64 ) / 64 )
+  , spill_( output_.storage() == ByteStream::Storage::Spill
+              ? optional<TempFileMapping> { in_place, ( mask_ + 64 ) / 64 * sizeof( uint64_t ) + mask_ + 1 }
+              : nullopt )
+  , first_unassembled_index_( 0 )
+  , bytes_pending_( 0 )
+  , intervals_( 0 )
+  , stored_end_( 0 )
+  , latest_stored_valid_( false )
+  , latest_stored_( 0 )
+  , max_intervals_( max_intervals )
+  , evicted_intervals_( 0 )
+  , evicted_bytes_( 0 )
+  , eof_seen_( false )
+  , eof_index_( 0 )
+{
+  trace<TraceLevel::Info>( "reassembler", "starting up with a window of {} bytes", mask_ + 1 );
+}
+
+// The mapping holds the bitmap's words, then the window (whose bytes need no alignment).
+uint64_t* Reassembler::present_bits()
+{
+  return spill_.has_value() ? reinterpret_cast<uint64_t*>( spill_->data() ) // NOLINT(*-reinterpret-cast)
+                            : present_.data();
+}
+
+const uint64_t* Reassembler::present_bits() const
+{
+  return spill_.has_value() ? reinterpret_cast<const uint64_t*>( spill_->data() ) // NOLINT(*-reinterpret-cast)
+                            : present_.data();
+}
+
+char* Reassembler::window()
+{
+  return spill_.has_value() ? spill_->data() + ( mask_ + 64 ) / 64 * sizeof( uint64_t ) : window_.get();
+}
+
+const char* Reassembler::window() const
+{
+  return spill_.has_value() ? spill_->data() + ( mask_ + 64 ) / 64 * sizeof( uint64_t ) : window_.get();
+}
 
-  // writable window: what we can actually fit into the output rn
-  uint64_t window_start = first_unassembled_index_;
-  uint64_t capacity = output_.writer().available_capacity();
-  uint64_t window_end = window_start + capacity;
+uint64_t Reassembler::mark_present( uint64_t first, uint64_t last )
+{
+  uint64_t newly_set = 0;
+  uint64_t* present = present_bits();
+  for_each_ring_word( first, last, mask_, [&]( uint64_t word, uint64_t mask ) {
+    newly_set += popcount( mask & ~present[word] );
+    present[word] |= mask;
+  } );
+  return newly_set;
+}
 
-  // if the chunk ends before the stuff we already assembled, discard
-  if ( orig_end <= window_start ) {
-    if ( eof_seen_ && first_unassembled_index_ >= eof_index_ ) {
-      cout << "Stream completed already. gg ez" << endl;
-      output_.writer().close();
+void Reassembler::clear_present( uint64_t first, uint64_t last )
+{
+  uint64_t* present = present_bits();
+  for_each_ring_word( first, last, mask_, [&]( uint64_t word, uint64_t mask ) { present[word] &= ~mask; } );
+}
+
+uint64_t Reassembler::find( uint64_t first, uint64_t last, bool present ) const
+{
+  const uint64_t* bits = present_bits();
+  while ( first < last ) {
+    const uint64_t pos = first & mask_;
+    const uint64_t offset = pos % 64;
+    const uint64_t span = min( { 64 - offset, mask_ + 1 - pos, last - first } );
+    const uint64_t word = bits[pos / 64] >> offset;
+    const uint64_t skip = countr_zero( present ? word : ~word );
+    if ( skip < span ) {
+      return first + skip;
     }
-    return;
+    first += span;
   }
+  return last;
+}
 
-  // trim chunk so it fits in window
-  uint64_t new_first = max<uint64_t>( orig_first, window_start );
-  if ( new_first >= window_end ) {
-    cout << "This chunk is too far ahead bruh, can’t handle it yet" << endl;
-    return;
+uint64_t Reassembler::find_back( uint64_t first, uint64_t last, bool present ) const
+{
+  const uint64_t* bits = present_bits();
+  while ( first < last ) {
+    const uint64_t pos = ( last - 1 ) & mask_;
+    const uint64_t offset = pos % 64;
+    const uint64_t span = min( offset + 1, last - first );
+    const uint64_t word = bits[pos / 64] << ( 63 - offset );
+    const uint64_t skip = countl_zero( present ? word : ~word );
+    if ( skip < span ) {
+      return last - skip;
+    }
+    last -= span;
   }
-  uint64_t new_end = min<uint64_t>( orig_end, window_end );
-  size_t offset = static_cast<size_t>( new_first - orig_first );
-  size_t keep_len = static_cast<size_t>( new_end - new_first );
-  string piece = data.substr( offset, keep_len );
+  return first;
+}
 
-  if ( piece.empty() )
-    return;
+uint64_t Reassembler::count_runs( uint64_t first, uint64_t last ) const
+{
+  uint64_t runs = 0;
+  for ( uint64_t pos = find( first, last, true ); pos < last; pos = find( pos, last, true ) ) {
+    ++runs;
+    pos = find( pos, last, false );
+  }
+  return runs;
+}
 
-  // merging overlapping chunks (this is the fun messy part)
-  uint64_t merged_first = new_first;
-  uint64_t merged_end = new_end;
-
-  auto it = buffer_.lower_bound( new_first );
-  if ( it != buffer_.begin() )
-    --it; // go one step back to catch neighbors
-
-  vector<pair<uint64_t, string>> overlapping;
-  while ( it != buffer_.end() ) {
-    uint64_t seg_first = it->first;
-    uint64_t seg_end = seg_first + it->second.size();
-
-    if ( seg_end < merged_first ) {
-      ++it;
-      continue;
-    } // segment ends before us
-    if ( seg_first > merged_end )
-      break; // segment starts after us
-
-    overlapping.emplace_back( seg_first, it->second ); // ok they overlap
-    merged_first = min( merged_first, seg_first );
-    merged_end = max( merged_end, seg_end );
-
-    ++it;
-  }
-
-  // if we found overlaps, do another sweep in case merging grew
-  if ( !overlapping.empty() ) {
-    overlapping.clear();
-    it = buffer_.lower_bound( merged_first );
-    if ( it != buffer_.begin() )
-      --it;
-    while ( it != buffer_.end() ) {
-      uint64_t seg_first = it->first;
-      uint64_t seg_end = seg_first + it->second.size();
-      if ( seg_end < merged_first ) {
-        ++it;
-        continue;
+void Reassembler::evict_farthest()
+{
+  const uint64_t end = find_back( first_unassembled_index_, stored_end_, true );
+  const uint64_t first = find_back( first_unassembled_index_, end, false );
+  stored_end_ = first;
+  clear_present( first, end );
+  bytes_pending_ -= end - first;
+  --intervals_;
+  ++evicted_intervals_;
+  evicted_bytes_ += end - first;
+  trace<TraceLevel::Verbose>( "reassembler", "evicted {} bytes at {}", end - first, first );
+}
+
+void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
+{
+  latest_stored_valid_ = false;
+
+  // fast path: an in-order substring that doesn't overlap anything stored goes straight to the output, without
+  // a copy if the output adopts pushed strings
+  if ( first_index == first_unassembled_index_ and not data.empty() ) {
+    const uint64_t len = min<uint64_t>( data.size(), output_.writer().available_capacity() );
+    if ( bytes_pending_ == 0 or find( first_index, first_index + len, true ) == first_index + len ) {
+      if ( is_last_substring ) {
+        eof_seen_ = true;
+        eof_index_ = first_index + data.size();
       }
-      if ( seg_first > merged_end )
-        break;
-      overlapping.emplace_back( seg_first, it->second );
-      merged_first = min( merged_first, seg_first );
-      merged_end = max( merged_end, seg_end );
-      ++it;
+      output_.writer().push( move( data ) );
+      first_unassembled_index_ += len;
+      finish(); // in case it closed a hole
+      return;
     }
   }
 
-  // big combined buffer for everything in [merged_first, merged_end)
-  size_t merged_size = static_cast<size_t>( merged_end - merged_first );
-  vector<char> merged_bytes( merged_size, 0 ); // 0 means “empty slot”
-  vector<char> present( merged_size, 0 );      // tracks filled slots
+  store( first_index, data, is_last_substring, first_unassembled_index_ + output_.writer().available_capacity() );
+  ChunkPool::release( move( data ) );
+  finish();
+}
 
-  // put the new data inside the merged buffer
-  for ( size_t i = 0; i < piece.size(); ++i ) {
-    size_t idx = static_cast<size_t>( new_first - merged_first ) + i;
-    merged_bytes[idx] = piece[i];
-    present[idx] = 1;
+void Reassembler::insert_batch( span<Segment> segments )
+{
+  // nothing is written to the output until the end, so the window stays put for the whole batch
+  latest_stored_valid_ = false;
+  const uint64_t window_end = first_unassembled_index_ + output_.writer().available_capacity();
+  for ( auto& segment : segments ) {
+    store( segment.first_index, segment.data, segment.is_last_substring, window_end );
+    ChunkPool::release( move( segment.data ) );
   }
+  finish();
+}
 
-  // copy data from overlapping old chunks into merged buffer
-  for ( auto& pr : overlapping ) {
-    uint64_t seg_first = pr.first;
-    string& seg_data = pr.second;
-    for ( size_t i = 0; i < seg_data.size(); ++i ) {
-      size_t idx = static_cast<size_t>( seg_first - merged_first ) + i;
-      merged_bytes[idx] = seg_data[i];
-      present[idx] = 1;
-    }
-  }
+void Reassembler::store( uint64_t first_index, string_view data, bool is_last_substring, uint64_t window_end )
+{
+  // original end of this incoming chunk
+  const uint64_t orig_end = first_index + data.size();
 
-  // clear the old overlapping entries from buffer (they’re merged now)
-  for ( auto& pr : overlapping )
-    buffer_.erase( pr.first );
+  // if this is the last substring, remember where the stream ends
+  if ( is_last_substring ) {
+    eof_seen_ = true;
+    eof_index_ = orig_end;
+  }
 
-  // cut the merged range back into continuous filled segments
-  size_t pos = 0;
-  while ( pos < merged_size ) {
-    if ( !present[pos] ) {
-      ++pos;
-      continue;
-    }
-    size_t start = pos;
-    while ( pos < merged_size && present[pos] )
-      ++pos;
-    size_t len = pos - start;
-    string out;
-    out.reserve( len );
-    for ( size_t k = 0; k < len; ++k )
-      out.push_back( merged_bytes[start + k] );
-    uint64_t store_index = merged_first + start;
-    buffer_[store_index] = move( out );
-    cout << "Stored chunk at " << store_index << " size " << buffer_[store_index].size() << " (yes chef)" << endl;
+  // trim chunk so it fits in window
+  const uint64_t window_start = first_unassembled_index_;
+  const uint64_t new_first = max( first_index, window_start );
+  const uint64_t new_end = min( orig_end, window_end );
+  if ( new_first >= window_end and not data.empty() ) {
+    trace<TraceLevel::Verbose>(
+      "reassembler", "dropped chunk at {}: beyond the window end {}", first_index, window_end );
+  }
+  if ( new_first >= new_end ) {
+    return;
   }
 
+  // copy the new bytes into place; any bytes already present are the same, so overwriting them is harmless
+  const char* src = data.data() + ( new_first - first_index );
+  const uint64_t len = new_end - new_first;
+  const uint64_t start = new_first & mask_;
+  const uint64_t first_part = min( len, mask_ + 1 - start );
+  memcpy( window() + start, src, first_part );
+  memcpy( window(), src + first_part, len - first_part );
+
+  // the new run absorbs every stored run it overlaps or touches
+  const uint64_t neighborhood_first = new_first > window_start ? new_first - 1 : new_first;
+  const uint64_t neighborhood_end = min( new_end + 1, window_start + mask_ + 1 );
+  intervals_ = intervals_ + 1 - count_runs( neighborhood_first, neighborhood_end );
+  bytes_pending_ += mark_present( new_first, new_end );
+  stored_end_ = max( stored_end_, new_end );
+  latest_stored_valid_ = true;
+  latest_stored_ = new_first;
+  trace<TraceLevel::Verbose>( "reassembler", "stored {} bytes at {}", len, new_first );
+}
+
+void Reassembler::finish()
+{
   // push out any data that starts exactly where we left off
-  while ( true ) {
-    auto itf = buffer_.find( first_unassembled_index_ );
-    if ( itf == buffer_.end() )
-      break;
-    string& s = itf->second;
-    output_.writer().push( s );
-    first_unassembled_index_ += s.size();
-    buffer_.erase( itf );
+  const uint64_t window_end = first_unassembled_index_ + output_.writer().available_capacity();
+  uint64_t remaining = find( first_unassembled_index_, window_end, false ) - first_unassembled_index_;
+  if ( remaining > 0 ) {
+    clear_present( first_unassembled_index_, first_unassembled_index_ + remaining );
+    bytes_pending_ -= remaining;
+    --intervals_;
+  }
+  while ( remaining > 0 ) {
+    const uint64_t start = first_unassembled_index_ & mask_;
+    auto space = output_.writer().reserve( min( remaining, mask_ + 1 - start ) );
+    memcpy( space.data(), window() + start, space.size() );
+    output_.writer().commit( space.size() );
+    first_unassembled_index_ += space.size();
+    remaining -= space.size();
+  }
+
+  // enforce the fragmentation budget, giving up the bytes we'll need last
+  while ( intervals_ > max_intervals_ ) {
+    evict_farthest();
   }
 
   // close stream if we’re fully done
-  if ( eof_seen_ && first_unassembled_index_ >= eof_index_ ) {
-    cout << "Stream completed 🎉 Mission accomplished, roll credits" << endl;
+  if ( eof_seen_ && first_unassembled_index_ >= eof_index_ and not output_.writer().is_closed() ) {
+    trace<TraceLevel::Info>( "reassembler", "stream complete after {} bytes", eof_index_ );
     output_.writer().close();
   }
 }
 
 uint64_t Reassembler::count_bytes_pending() const
 {
-  uint64_t total = 0;
-  for ( const auto& kv : buffer_ )
-    total += kv.second.size();
-  return total;
-}
\ No newline at end of file
+  return bytes_pending_;
+}
+
+vector<Reassembler::Interval> Reassembler::pending_intervals( size_t max_count ) const
+{
+  vector<Interval> intervals;
+  uint64_t found = 0;
+  uint64_t pos = first_unassembled_index_;
+  const uint64_t window_end = first_unassembled_index_ + mask_ + 1;
+
+  // stop as soon as every pending byte has been accounted for, rather than scanning the whole window
+  while ( intervals.size() < max_count and found < bytes_pending_ ) {
+    const uint64_t first = find( pos, window_end, true );
+    const uint64_t end = find( first, window_end, false );
+    intervals.push_back( { first, end } );
+    found += end - first;
+    pos = end;
+  }
+  return intervals;
+}
+
+optional<Reassembler::Interval> Reassembler::interval_containing( uint64_t index ) const
+{
+  if ( index < first_unassembled_index_ or index >= stored_end_ or find( index, index + 1, true ) != index ) {
+    return nullopt;
+  }
+  return Interval { find_back( first_unassembled_index_, index, false ), find( index, stored_end_, false ) };
+}
+
+optional<Reassembler::Interval> Reassembler::latest_interval() const
+{
+  if ( not latest_stored_valid_ ) {
+    return nullopt;
+  }
+  return interval_containing( latest_stored_ );
+}
@@ -2,23 +2,67 @@
 
 #include "byte_stream.hh"
 #include <cstdint>
-#include <map>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 using namespace std;
 
 class Reassembler
 {
 public:
+  // Default limit on the number of disjoint runs of stored bytes (see count_pending_intervals).
+  static constexpr uint64_t DEFAULT_MAX_INTERVALS = 1024;
+
   // Construct Reassembler to write into given ByteStream.
-  explicit Reassembler( ByteStream&& output );
+  // If storing a substring would leave more than `max_intervals` disjoint runs of bytes waiting for a gap to be
+  // filled, the runs farthest from the first unassembled index are dropped until it doesn't.
+  explicit Reassembler( ByteStream&& output, uint64_t max_intervals = DEFAULT_MAX_INTERVALS );
 
   // Insert a new substring to be reassembled into a ByteStream.
   void insert( uint64_t first_index, string data, bool is_last_substring );
 
+  struct Segment
+  {
+    uint64_t first_index;
+    std::string data;
+    bool is_last_substring;
+  };
+
+  // Insert a burst of substrings, in any order, as if by insert() on each, but writing to the ByteStream
+  // once at the end. The segments' data is consumed.
+  void insert_batch( std::span<Segment> segments );
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t count_bytes_pending() const;
 
+  // A run of stored bytes, [first, end), that can't be written yet because of a gap before it.
+  struct Interval
+  {
+    uint64_t first;
+    uint64_t end;
+    bool operator==( const Interval& other ) const = default;
+  };
+
+  // How many disjoint runs of bytes are stored?
+  uint64_t count_pending_intervals() const { return intervals_; }
+
+  // How many runs (and bytes) have been dropped to stay within the interval limit?
+  uint64_t evicted_intervals() const { return evicted_intervals_; }
+  uint64_t evicted_bytes() const { return evicted_bytes_; }
+
+  // The first (lowest) `max_count` runs of stored bytes, in order, e.g. to advertise as selective acks.
+  std::vector<Interval> pending_intervals( size_t max_count ) const;
+
+  // The run of stored bytes that contains `index`, if that byte is stored
+  std::optional<Interval> interval_containing( uint64_t index ) const;
+
+  // The run that the latest insert (or the last segment of the latest batch) landed in, if it is still stored
+  std::optional<Interval> latest_interval() const;
+
   // Access output stream reader
   Reader& reader() { return output_.reader(); }
   const Reader& reader() const { return output_.reader(); }
@@ -30,13 +74,54 @@ public:
 private:
   ByteStream output_;
 
+  // Pending bytes are stored in a circular window, allocated once, whose size is a power of two no smaller than
+  // the output's capacity: the byte at absolute index i lives at window_[i & mask_], and bit (i & mask_) of
+  // present_ records whether it has arrived. Every buffered byte is within capacity of the next byte
+  // expected, so no two of them share a slot. If the output spills to a temporary file, the bitmap and window
+  // do too (in a mapping of their own, the bitmap first), so a large capacity commits no memory up front.
+  uint64_t mask_;
+  std::unique_ptr<char[]> window_;
+  std::vector<uint64_t> present_;
+  std::optional<TempFileMapping> spill_;
+
+  char* window();
+  const char* window() const;
+  uint64_t* present_bits();
+  const uint64_t* present_bits() const;
+
   // Next byte index expected to be written
   uint64_t first_unassembled_index_;
 
+  // Number of bits set in present_, and of runs of them
+  uint64_t bytes_pending_;
+  uint64_t intervals_;
+
+  // No stored byte is at or beyond this index (so eviction needn't scan the empty end of the window)
+  uint64_t stored_end_;
+
+  // The first byte that the latest insert stored, if it stored any
+  bool latest_stored_valid_;
+  uint64_t latest_stored_;
+
+  // Fragmentation budget (see constructor) and what enforcing it has cost
+  uint64_t max_intervals_;
+  uint64_t evicted_intervals_;
+  uint64_t evicted_bytes_;
+
   // EOF tracking: whether we've seen a last-substring marker and where the stream ends
   bool eof_seen_;
   uint64_t eof_index_; // absolute index of first byte *after* the last byte (i.e. end index)
 
-  // Buffer for unassembled substrings (start index -> data)
-  map<uint64_t, string> buffer_;
-};
\ No newline at end of file
+  // copy a substring's bytes within [first_unassembled_index_, window_end) into the window
+  void store( uint64_t first_index, std::string_view data, bool is_last_substring, uint64_t window_end );
+  void finish(); // write out the bytes that are ready, enforce the interval budget, and close at the end
+
+  uint64_t mark_present( uint64_t first, uint64_t last ); // returns how many of the bits were newly set
+  void clear_present( uint64_t first, uint64_t last );
+  // the first index in [first, last) whose presence bit equals `present`, or `last` if there is none
+  uint64_t find( uint64_t first, uint64_t last, bool present ) const;
+  // one past the last index in [first, last) whose presence bit equals `present`, or `first` if there is none
+  uint64_t find_back( uint64_t first, uint64_t last, bool present ) const;
+  uint64_t count_runs( uint64_t first, uint64_t last ) const; // runs of present bytes overlapping [first, last)
+  void evict_farthest();
+};
@@ -0,0 +1,174 @@
+#include "spsc_byte_stream.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+namespace {
+FileDescriptor make_eventfd()
+{
+  return FileDescriptor { CheckSystemCall( "eventfd", eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) };
+}
+} // namespace
+
+SPSCByteStream::SPSCByteStream( uint64_t capacity, bool wakeups )
+  : capacity_( capacity ), storage_( bit_ceil( max<uint64_t>( capacity, 1 ) ) ), mask_( storage_.size() - 1 )
+{
+  if ( wakeups ) {
+    data_event_.emplace( make_eventfd() );
+    space_event_.emplace( make_eventfd() );
+  }
+}
+
+void SPSCByteStream::signal( optional<FileDescriptor>& event )
+{
+  if ( event.has_value() ) {
+    const uint64_t one = 1;
+    event->write( string_view { reinterpret_cast<const char*>( &one ), sizeof( one ) } ); // NOLINT(*-reinterpret-cast)
+  }
+}
+
+void SPSCByteStream::clear( optional<FileDescriptor>& event )
+{
+  if ( event.has_value() ) {
+    array<char, sizeof( uint64_t )> counter {};
+    event->read( span<char> { counter } );
+  }
+}
+
+void SPSCByteStream::push( string_view data )
+{
+  // Only this thread advances pushed_; the reader may concurrently advance popped_, which only frees space.
+  const uint64_t pushed = pushed_.load( memory_order_relaxed );
+  const uint64_t popped = popped_.load( memory_order_acquire );
+  const uint64_t len = min<uint64_t>( data.size(), capacity_ - ( pushed - popped ) );
+  if ( len == 0 ) {
+    return;
+  }
+
+  const uint64_t start = pushed & mask_;
+  const uint64_t first_part = min<uint64_t>( len, storage_.size() - start );
+  memcpy( storage_.data() + start, data.data(), first_part );
+  memcpy( storage_.data(), data.data() + first_part, len - first_part );
+
+  pushed_.store( pushed + len, memory_order_release );
+
+  // If the reader had drained everything before this push, it may be waiting on an empty stream. The fence
+  // (paired with the one in pop) ensures that either we see its final pop or it sees this push.
+  if ( data_event_.has_value() ) {
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( popped_.load( memory_order_relaxed ) == pushed ) {
+      signal( data_event_ );
+    }
+  }
+}
+
+void SPSCByteStream::close()
+{
+  closed_.store( true, memory_order_release );
+  signal( data_event_ );
+}
+
+bool SPSCByteStream::is_closed() const
+{
+  return closed_.load( memory_order_acquire );
+}
+
+uint64_t SPSCByteStream::available_capacity() const
+{
+  return capacity_ - ( pushed_.load( memory_order_relaxed ) - popped_.load( memory_order_acquire ) );
+}
+
+uint64_t SPSCByteStream::bytes_pushed() const
+{
+  return pushed_.load( memory_order_acquire );
+}
+
+string_view SPSCByteStream::peek() const
+{
+  const uint64_t popped = popped_.load( memory_order_relaxed );
+  const uint64_t buffered = pushed_.load( memory_order_acquire ) - popped;
+  const uint64_t start = popped & mask_;
+  return { storage_.data() + start, min<uint64_t>( buffered, storage_.size() - start ) };
+}
+
+void SPSCByteStream::pop( uint64_t len )
+{
+  const uint64_t popped = popped_.load( memory_order_relaxed );
+  len = min( len, pushed_.load( memory_order_acquire ) - popped );
+  if ( len == 0 ) {
+    return;
+  }
+
+  popped_.store( popped + len, memory_order_release );
+
+  // If the stream was full before this pop, the writer may be waiting for space (see push).
+  if ( space_event_.has_value() ) {
+    atomic_thread_fence( memory_order_seq_cst );
+    if ( pushed_.load( memory_order_relaxed ) - popped >= capacity_ ) {
+      signal( space_event_ );
+    }
+  }
+}
+
+bool SPSCByteStream::is_finished() const
+{
+  // Load closed_ first: once it is visible, so are all the pushes that preceded close().
+  return closed_.load( memory_order_acquire ) and bytes_buffered() == 0;
+}
+
+uint64_t SPSCByteStream::bytes_buffered() const
+{
+  return pushed_.load( memory_order_acquire ) - popped_.load( memory_order_relaxed );
+}
+
+uint64_t SPSCByteStream::bytes_popped() const
+{
+  return popped_.load( memory_order_acquire );
+}
+
+void SPSCByteStream::set_error()
+{
+  error_.store( true, memory_order_release );
+  signal( data_event_ );
+  signal( space_event_ );
+}
+
+bool SPSCByteStream::has_error() const
+{
+  return error_.load( memory_order_acquire );
+}
+
+FileDescriptor& SPSCByteStream::data_event()
+{
+  if ( not data_event_.has_value() ) {
+    throw runtime_error( "SPSCByteStream constructed without wakeups" );
+  }
+  return *data_event_;
+}
+
+FileDescriptor& SPSCByteStream::space_event()
+{
+  if ( not space_event_.has_value() ) {
+    throw runtime_error( "SPSCByteStream constructed without wakeups" );
+  }
+  return *space_event_;
+}
+
+void SPSCByteStream::clear_data_event()
+{
+  clear( data_event_ );
+}
+
+void SPSCByteStream::clear_space_event()
+{
+  clear( space_event_ );
+}
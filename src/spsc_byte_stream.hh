@@ -0,0 +1,77 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+/*
+ * SPSCByteStream: a ByteStream that can be shared by two threads without locks, as long as one thread
+ * only uses the writer methods and the other only uses the reader methods (single producer, single
+ * consumer). Bytes are handed over through a ring buffer whose head and tail counters are atomics on
+ * separate cache lines, so a hand-off costs a memcpy rather than a pair of system calls.
+ *
+ * If constructed with `wakeups`, the stream also owns two eventfds that a thread can poll (e.g. with an
+ * EventLoop rule) instead of spinning:
+ *    - data_event() becomes readable when bytes are pushed into an empty stream, or on close/error.
+ *    - space_event() becomes readable when bytes are popped from a full stream, or on error.
+ * After waking, clear the event before re-checking the stream so that no wakeup is lost.
+ */
+class SPSCByteStream
+{
+public:
+  explicit SPSCByteStream( uint64_t capacity, bool wakeups = false );
+
+  // Writer thread only
+  void push( std::string_view data ); // Push data to stream, but only as much as available capacity allows.
+  void close();                       // Signal that the stream has reached its ending.
+  bool is_closed() const;
+  uint64_t available_capacity() const;
+  uint64_t bytes_pushed() const;
+
+  // Reader thread only
+  std::string_view peek() const; // Peek at the next bytes in the buffer (up to the end of the ring)
+  void pop( uint64_t len );      // Remove `len` bytes from the buffer
+  bool is_finished() const;
+  uint64_t bytes_buffered() const;
+  uint64_t bytes_popped() const;
+
+  // Either thread
+  void set_error();
+  bool has_error() const;
+
+  // Wakeup notifications (only if constructed with `wakeups`)
+  FileDescriptor& data_event();
+  FileDescriptor& space_event();
+  void clear_data_event();
+  void clear_space_event();
+
+  // The counters are shared between threads, so the stream can be neither copied nor moved.
+  SPSCByteStream( const SPSCByteStream& other ) = delete;
+  SPSCByteStream& operator=( const SPSCByteStream& other ) = delete;
+  SPSCByteStream( SPSCByteStream&& other ) = delete;
+  SPSCByteStream& operator=( SPSCByteStream&& other ) = delete;
+  ~SPSCByteStream() = default;
+
+private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  uint64_t capacity_;
+  std::vector<char> storage_; // size is a power of two no smaller than the capacity
+  uint64_t mask_;
+
+  std::optional<FileDescriptor> data_event_ {};
+  std::optional<FileDescriptor> space_event_ {};
+
+  // Each counter is written by one thread only and lives on its own cache line.
+  alignas( kCacheLineSize ) std::atomic<uint64_t> pushed_ {};
+  alignas( kCacheLineSize ) std::atomic<uint64_t> popped_ {};
+  alignas( kCacheLineSize ) std::atomic<bool> closed_ {};
+  std::atomic<bool> error_ {};
+
+  static void signal( std::optional<FileDescriptor>& event );
+  static void clear( std::optional<FileDescriptor>& event );
+};
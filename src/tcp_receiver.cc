@@ -1,6 +1,8 @@
 #include "tcp_receiver.hh"
 #include "debug.hh"
 
+#include <algorithm>
+
 using namespace std;
 
 void TCPReceiver::receive(TCPSenderMessage message) {
@@ -14,13 +16,17 @@ void TCPReceiver::receive(TCPSenderMessage message) {
     if (!isn_set_ && message.SYN) {
         isn_ = message.seqno;
         isn_set_ = true;
+        sack_permitted_ = sack_enabled_ && message.sack_permitted;
+        if (window_scale_offered_.has_value() && message.window_scale.has_value()) {
+            window_shift_ = *window_scale_offered_;
+        }
     }
 
     // Can't process anything until we've seen the SYN
     if (!isn_set_) return;
 
     // 2. Compute checkpoint for unwrap (first unassembled)
-    uint64_t checkpoint = reassembler_.reader().bytes_popped() + reassembler_.count_bytes_pending();
+    uint64_t checkpoint = reassembler_.writer().bytes_pushed();
 
     // 3. Convert seqno -> absolute seqno (0-based: SYN -> 0)
     uint64_t abs_seq = message.seqno.unwrap(isn_, checkpoint);
@@ -35,7 +41,25 @@ void TCPReceiver::receive(TCPSenderMessage message) {
     size_t stream_index = static_cast<size_t>(stream_index64);
 
     // 5. Always call insert so FIN is handled even when payload is empty
-    reassembler_.insert(stream_index, message.payload, message.FIN);
+    reassembler_.insert(stream_index, std::move(message.payload), message.FIN);
+
+    // 6. The next ack's first SACK block reports where this segment landed
+    if (sack_permitted_) note_sack_run();
+}
+
+void TCPReceiver::note_sack_run() {
+    const auto latest = reassembler_.latest_interval();
+    if (!latest.has_value()) return;
+
+    // forget runs that were delivered, evicted, or merged into this one
+    std::erase_if(sack_anchors_, [&](uint64_t anchor) {
+        const auto run = reassembler_.interval_containing(anchor);
+        return !run.has_value() || *run == *latest;
+    });
+    sack_anchors_.insert(sack_anchors_.begin(), latest->first);
+    if (sack_anchors_.size() > TCPReceiverMessage::MAX_SACK_BLOCKS) {
+        sack_anchors_.resize(TCPReceiverMessage::MAX_SACK_BLOCKS);
+    }
 }
 
 
@@ -52,9 +76,29 @@ TCPReceiverMessage TCPReceiver::send() const {
     }
 
     uint64_t avail = reassembler_.writer().available_capacity();
-    msg.window_size = static_cast<uint16_t>(std::min<uint64_t>(avail, 65535));
+    msg.window_size = static_cast<uint16_t>(std::min<uint64_t>(avail >> window_shift_, 65535));
 
     msg.RST = reassembler_.writer().has_error();
 
+    // Selective acks: the runs of bytes waiting behind a gap, as sequence numbers (+1 for SYN).
+    // The most recently reported runs go first, starting with the one the latest segment landed in
+    // (RFC 2018 section 4); any room left goes to the lowest of the others.
+    if (sack_permitted_) {
+        std::vector<Reassembler::Interval> runs;
+        for (const uint64_t anchor : sack_anchors_) {
+            const auto run = reassembler_.interval_containing(anchor);
+            if (run.has_value() && std::find(runs.begin(), runs.end(), *run) == runs.end()) {
+                runs.push_back(*run);
+            }
+        }
+        for (const auto &run : reassembler_.pending_intervals(TCPReceiverMessage::MAX_SACK_BLOCKS + runs.size())) {
+            if (runs.size() == TCPReceiverMessage::MAX_SACK_BLOCKS) break;
+            if (std::find(runs.begin(), runs.end(), run) == runs.end()) runs.push_back(run);
+        }
+        for (const auto &run : runs) {
+            msg.sack.push_back({Wrap32::wrap(run.first + 1, isn_), Wrap32::wrap(run.end + 1, isn_)});
+        }
+    }
+
     return msg;
 }
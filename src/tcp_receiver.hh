@@ -1,15 +1,24 @@
 #pragma once
 
 #include "reassembler.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <optional>
+#include <vector>
+
 class TCPReceiver
 {
 public:
   // Construct with given Reassembler
-explicit TCPReceiver(Reassembler&& reassembler)
-    : reassembler_(std::move(reassembler)), isn_(0), isn_set_(false) {}
+  // (and, from `config`, whether to send selective acknowledgments to a sender that permits them,
+  // and whether to scale the advertised window if the sender offers window scaling too)
+explicit TCPReceiver(Reassembler&& reassembler, const TCPConfig& config = {})
+    : reassembler_(std::move(reassembler)), isn_(0), isn_set_(false),
+      sack_enabled_(config.sack), sack_permitted_(false),
+      window_scale_offered_(config.window_scaling ? std::optional<uint8_t>(config.window_scale()) : std::nullopt),
+      window_shift_(0), sack_anchors_() {}
 
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into the Reassembler
@@ -20,6 +29,9 @@ explicit TCPReceiver(Reassembler&& reassembler)
   // The TCPReceiver sends TCPReceiverMessages to the peer's TCPSender.
   TCPReceiverMessage send() const;
 
+  // The advertised window counts in units of 2^window_shift() (0 unless window scaling was negotiated)
+  uint8_t window_shift() const { return window_shift_; }
+
   // Access the output
   const Reassembler& reassembler() const { return reassembler_; }
   Reader& reader() { return reassembler_.reader(); }
@@ -30,4 +42,12 @@ private:
   Reassembler reassembler_;
   Wrap32 isn_;       
   bool isn_set_; 
+  bool sack_enabled_;   // we may send SACK blocks...
+  bool sack_permitted_; // ...and the peer's SYN said it understands them
+  std::optional<uint8_t> window_scale_offered_; // the shift our own SYN offers, if any
+  uint8_t window_shift_;                        // ...in use once the peer's SYN offers scaling too
+  // A stream index in each of the runs reported in SACK blocks, the most recently reported (or extended) first
+  std::vector<uint64_t> sack_anchors_;
+
+  void note_sack_run(); // move the run the latest segment landed in to the front of sack_anchors_
 };
\ No newline at end of file
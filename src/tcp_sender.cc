@@ -3,6 +3,7 @@
 #include "tcp_config.hh"
 #include "wrapping_integers.hh"
 #include <algorithm>
+#include <cmath>
 
 using namespace std;
 
@@ -31,18 +32,33 @@ void TCPSender::track_outstanding(const TCPSenderMessage &m, uint64_t first_seqn
   Outstanding os;
   os.msg = m;
   os.first_seqno_abs = first_seqno_abs;
-  os.time_sent_ms = 0;
+  os.time_sent_ms = now_ms_;
+  os.delivered_at_send = last_acked_abs_;
+  in_flight_ += m.sequence_length();
   outstanding_.push_back(std::move(os));
   if (!timer_running_) start_timer();
 }
 
-/* Remove outstanding segments that are fully acked by ack_abs (ack_abs is the absolute ackno) */
-void TCPSender::remove_fully_acked(uint64_t ack_abs) {
+/* Remove outstanding segments that are fully acked by ack_abs (ack_abs is the absolute ackno),
+   timing the newest of them into `sample` -- unless any of them was retransmitted (Karn's rule): then the ack
+   may have been held back by the hole the retransmission filled, and says nothing about the newest one's trip */
+void TCPSender::remove_fully_acked(uint64_t ack_abs, AckSample &sample) {
+  bool retransmission_acked = false;
   while (!outstanding_.empty()) {
     const Outstanding &os = outstanding_.front();
     uint64_t seg_first = os.first_seqno_abs;
     uint64_t seg_end = seg_first + os.msg.sequence_length(); // one past last
     if (seg_end <= ack_abs) {
+      retransmission_acked |= os.retransmitted;
+      if (retransmission_acked) {
+        sample.rtt_ms.reset();
+        sample.prior_delivered.reset();
+      } else {
+        sample.rtt_ms = now_ms_ - os.time_sent_ms;
+        sample.prior_delivered = os.delivered_at_send;
+      }
+      in_flight_ -= os.msg.sequence_length();
+      if (os.sacked) sacked_bytes_ -= os.msg.sequence_length();
       outstanding_.pop_front();
     } else {
       break;
@@ -50,12 +66,116 @@ void TCPSender::remove_fully_acked(uint64_t ack_abs) {
   }
 }
 
+/* Fold an RTT sample into the smoothed estimates (RFC 6298 section 2) */
+void TCPSender::update_rtt(uint64_t rtt_ms) {
+  RTTStats &s = rtt_stats_;
+  const auto r = static_cast<double>(rtt_ms);
+  if (s.samples == 0) {
+    s.smoothed_ms = r;
+    s.variation_ms = r / 2;
+    s.min_ms = rtt_ms;
+  } else {
+    s.variation_ms = 0.75 * s.variation_ms + 0.25 * std::abs(s.smoothed_ms - r);
+    s.smoothed_ms = 0.875 * s.smoothed_ms + 0.125 * r;
+    s.min_ms = std::min(s.min_ms, rtt_ms);
+  }
+  ++s.samples;
+  s.latest_ms = rtt_ms;
+
+  // RTO = SRTT + max(G, K*RTTVAR), with a clock granularity G of 1 ms
+  const double rto = s.smoothed_ms + std::max(1.0, 4 * s.variation_ms);
+  s.estimated_RTO_ms = std::clamp(static_cast<uint64_t>(std::ceil(rto)), config_.rto_min_ms, config_.rto_max_ms);
+}
+
+/* An ack that repeats the last one, with the same window, while data is outstanding: a later segment
+   arrived, so an earlier one is probably lost (RFC 5681 section 3.2, RFC 6582) */
+void TCPSender::on_duplicate_ack() {
+  if (config_.dupack_threshold == 0 || outstanding_.empty()) return;
+  ++dup_acks_;
+
+  // each further duplicate means another segment has left the network
+  // (with SACK, the scoreboard already counts exactly which ones)
+  if (in_recovery_) {
+    if (!sack_in_use()) recovery_inflation_ += mss_;
+    return;
+  }
+
+  // (no new recovery for losses among what was sent before the last one began)
+  if (dup_acks_ == config_.dupack_threshold && last_acked_abs_ >= recover_) {
+    in_recovery_ = true;
+    recover_ = next_seqno_abs_;
+    cc_->on_loss(now_ms_, next_seqno_abs_ - last_acked_abs_);
+    recovery_inflation_ = sack_in_use() ? 0 : dup_acks_ * mss_;
+    for (auto &os : outstanding_) os.repaired = false;
+    retransmit_pending_ = true;
+  }
+}
+
+/* Mark the outstanding segments that SACK blocks cover (RFC 2018). Returns whether any were new. */
+bool TCPSender::update_scoreboard(const std::vector<TCPReceiverMessage::SackBlock> &blocks) {
+  if (!config_.sack) return false;
+  const Wrap32 last_acked = Wrap32::wrap(last_acked_abs_, isn_);
+  const Wrap32 next_seqno = Wrap32::wrap(next_seqno_abs_, isn_);
+  bool newly_sacked = false;
+
+  for (const auto &block : blocks) {
+    // ignore blocks that are empty, already acked, or beyond what was sent
+    if (block.right <= block.left || block.right <= last_acked || block.right > next_seqno) continue;
+    const uint64_t left_abs = last_acked_abs_ + (block.left <= last_acked ? 0 : block.left - last_acked);
+    const uint64_t right_abs = last_acked_abs_ + (block.right - last_acked);
+
+    // outstanding_ is in sequence order: mark each segment that lies entirely within the block
+    auto it = std::partition_point(outstanding_.begin(), outstanding_.end(),
+                                   [&](const Outstanding &os) { return os.first_seqno_abs < left_abs; });
+    for (; it != outstanding_.end(); ++it) {
+      const uint64_t seg_end = it->first_seqno_abs + it->msg.sequence_length();
+      if (seg_end > right_abs) break;
+      if (!it->sacked) {
+        it->sacked = true;
+        sacked_bytes_ += it->msg.sequence_length();
+        newly_sacked = true;
+      }
+      highest_sacked_abs_ = std::max(highest_sacked_abs_, seg_end);
+      peer_sacks_ = true;
+    }
+  }
+  return newly_sacked;
+}
+
+/* Resend a segment that an ack shows (or suggests) is lost */
+void TCPSender::resend(Outstanding &os, const TransmitFunction& transmit) {
+  transmit(os.msg);
+  os.retransmitted = true;
+  os.repaired = true;
+  ++fast_retransmissions_;
+}
+
+/* Resend the holes the scoreboard shows: each unSACKed segment below the highest SACKed one, once per loss,
+   and while the congestion window allows -- but always at least one (RFC 6675 section 5).
+   Without SACK information, guess that the oldest outstanding segment is the one missing (RFC 6582). */
+void TCPSender::retransmit_holes(const TransmitFunction& transmit) {
+  if (outstanding_.empty()) return;
+
+  if (highest_sacked_abs_ <= last_acked_abs_) {
+    if (!outstanding_.front().repaired) resend(outstanding_.front(), transmit);
+    return;
+  }
+
+  const uint64_t pipe = in_flight_ - sacked_bytes_;
+  bool sent = false;
+  for (auto &os : outstanding_) {
+    if (os.first_seqno_abs >= highest_sacked_abs_) break;
+    if (os.sacked || os.repaired) continue;
+    if (sent && pipe >= cc_->cwnd()) break;
+    resend(os, transmit);
+    sent = true;
+  }
+}
+
 /* ---------------- Accessors ---------------- */
 
 uint64_t TCPSender::sequence_numbers_in_flight() const {
-  uint64_t sum = 0;
-  for (const auto &os : outstanding_) sum += os.msg.sequence_length();
-  return sum;
+  return in_flight_;
 }
 
 uint64_t TCPSender::consecutive_retransmissions() const {
@@ -87,27 +207,28 @@ TCPSenderMessage TCPSender::make_empty_message() const {
    Fill the receiver's window by reading from the ByteStream and sending segments.
 */
 void TCPSender::push(const TransmitFunction& transmit) {
-  // compute effective window (special-case: treat zero window as 1 for this call only)
-  uint64_t effective_window = window_size_;
-  if (effective_window == 0) effective_window = 1;
+  // Loss recovery asked for lost segments to be resent (they're already counted in flight).
+  if (retransmit_pending_) {
+    retransmit_pending_ = false;
+    retransmit_holes(transmit);
+  }
 
-  // how many sequence numbers already in flight (from last_ack_abs_)
-  uint64_t in_flight = sequence_numbers_in_flight();
+  // The receiver's window bounds everything in flight (special-case: treat zero window as 1 for this call only).
+  // The congestion window (inflated during fast recovery) bounds what is still in the network, which doesn't
+  // include what the receiver has SACKed.
+  const uint64_t receiver_window = window_size_ == 0 ? 1 : window_size_;
+  const uint64_t cwnd = cc_->cwnd() + std::min(recovery_inflation_, UINT64_MAX - cc_->cwnd());
 
-  // available = (last_acked_abs_ + effective_window) - (last_acked_abs_ + in_flight)
-  // simplify:
-  if (last_acked_abs_ + in_flight >= last_acked_abs_ + effective_window) {
-    // window full
-    return;
-  }
+  // a paced controller also limits how much goes out before the next tick
+  const bool paced = cc_->pacing_rate() > 0;
 
   // keep sending until window full or no more data (and SYN/FIN conditions)
   while (true) {
     uint64_t used = sequence_numbers_in_flight();
-    uint64_t window_right = last_acked_abs_ + effective_window;
-    if (window_right <= last_acked_abs_ + used) break;
-    uint64_t avail = window_right - (last_acked_abs_ + used);
-    if (avail == 0) break;
+    uint64_t pipe = used - sacked_bytes_;
+    if (used >= receiver_window || pipe >= cwnd) break;
+    uint64_t avail = std::min(receiver_window - used, cwnd - pipe);
+    if (paced && pacing_budget_ <= 0) break;
 
     TCPSenderMessage seg;
     seg.payload.clear();
@@ -119,6 +240,12 @@ void TCPSender::push(const TransmitFunction& transmit) {
     if (!syn_sent_) {
       // SYN occupies one sequence number
       seg.SYN = true;
+      // (a SYN-ACK may only offer what the peer's SYN did)
+      seg.sack_permitted = config_.sack && (!peer_syn_received_ || peer_sack_permitted_);
+      if (config_.window_scaling && (!peer_syn_received_ || peer_offers_window_scale_)) {
+        seg.window_scale = config_.window_scale();
+      }
+      if (config_.mtu > 0) seg.mss = static_cast<uint16_t>(config_.mss());
     }
 
     // figure out how much payload we can take
@@ -126,7 +253,8 @@ void TCPSender::push(const TransmitFunction& transmit) {
     // available for payload = avail - (SYN?1:0)
     uint64_t after_syn = (seg.SYN ? (avail >= 1 ? avail - 1 : 0) : avail);
     if (after_syn > 0) {
-      max_payload = static_cast<size_t>(std::min<uint64_t>(after_syn, TCPConfig::MAX_PAYLOAD_SIZE));
+      const uint64_t payload_room = mss_ > option_space_ ? mss_ - option_space_ : 1;
+      max_payload = static_cast<size_t>(std::min<uint64_t>(after_syn, payload_room));
     } else {
       max_payload = 0;
     }
@@ -173,6 +301,7 @@ void TCPSender::push(const TransmitFunction& transmit) {
 
     // transmit
     transmit(seg);
+    if (paced) pacing_budget_ -= static_cast<int64_t>(seg_len);
 
     // track as outstanding (if consumes sequence space)
     if (seg_len > 0) {
@@ -194,34 +323,76 @@ void TCPSender::receive(const TCPReceiverMessage& msg) {
   }
 
   // Update window size immediately (even if ack missing/ignored).
-  window_size_ = msg.window_size;
+  const uint64_t previous_window = window_size_;
+  window_size_ = static_cast<uint64_t>(msg.window_size) << peer_window_shift_;
 
   // If no ack number is present, nothing more to do.
   if (!msg.ackno.has_value()) {
     return;
   }
 
-  // Unwrap ackno into absolute sequence number (use next_seqno_abs_ as checkpoint).
-  Wrap32 w = msg.ackno.value();
-  uint64_t ack_abs = w.unwrap(isn_, next_seqno_abs_);
+  // Validate the ackno in sequence space, relative to what we've sent and what was already acked
+  // (serial-number comparisons, so no unwrapping is needed).
+  const Wrap32 ackno = msg.ackno.value();
+  const Wrap32 last_acked = Wrap32::wrap(last_acked_abs_, isn_);
 
   // === IMPORTANT: ignore impossible ACKs beyond what we've sent ===
   // If the peer is claiming to have received bytes we never sent, ignore this ACK.
-  if (ack_abs > next_seqno_abs_) {
+  if (ackno > Wrap32::wrap(next_seqno_abs_, isn_)) {
     return;
   }
 
-  // Ignore non-advancing acks.
-  if (ack_abs <= last_acked_abs_) {
+  // Note which outstanding segments the receiver already holds.
+  // While losses are being repaired, newly SACKed data may show more holes to resend.
+  const bool newly_sacked = update_scoreboard(msg.sack);
+  if (newly_sacked && last_acked_abs_ < recover_) retransmit_pending_ = true;
+
+  // Ignore non-advancing acks (except to count duplicates).
+  if (ackno <= last_acked) {
+    if (ackno == last_acked && window_size_ == previous_window) on_duplicate_ack();
     return;
   }
+  const uint64_t ack_abs = last_acked_abs_ + (ackno - last_acked);
 
   // This is a valid, new ack: update last ack and remove fully acknowledged segments.
+  AckSample sample;
+  sample.now_ms = now_ms_;
+  sample.bytes_acked = ack_abs - last_acked_abs_;
   last_acked_abs_ = ack_abs;
-  remove_fully_acked(ack_abs);
+  remove_fully_acked(ack_abs, sample);
+  if (sample.rtt_ms.has_value()) update_rtt(*sample.rtt_ms);
+
+  // During fast recovery, an ack short of `recover_` shows the next hole: resend it right away,
+  // and deflate the window by what left the network (RFC 6582 section 3.2).
+  // Otherwise the loss is repaired; the window deflates back to what the congestion controller set.
+  sample.in_recovery = in_recovery_;
+  dup_acks_ = 0;
+  if (in_recovery_ && ack_abs < recover_) {
+    retransmit_pending_ = true;
+    if (!sack_in_use()) {
+      recovery_inflation_ -= std::min(recovery_inflation_, sample.bytes_acked);
+      recovery_inflation_ += mss_;
+    }
+  } else {
+    in_recovery_ = false;
+    recovery_inflation_ = 0;
+    // (after a timeout, the holes are resent as acks come back: those the peer SACKs again show where they are,
+    // and otherwise the oldest outstanding segment is the next one missing)
+    if (ack_abs < recover_ && sack_in_use()) retransmit_pending_ = true;
+  }
+
+  // Tell the congestion controller.
+  sample.bytes_in_flight = next_seqno_abs_ - ack_abs;
+  sample.delivered = ack_abs;
+  cc_->on_ack(sample);
 
   // Reset retransmission timeout (RTO) and consecutive retransmission counter.
-  current_RTO_ms_ = initial_RTO_ms_;
+  // (An adaptive RTO stays backed off until a segment sent only once is acked.)
+  if (!config_.adaptive_rto) {
+    current_RTO_ms_ = initial_RTO_ms_;
+  } else if (sample.rtt_ms.has_value()) {
+    current_RTO_ms_ = rtt_stats_.estimated_RTO_ms;
+  }
   consecutive_retransmissions_ = 0;
 
   // If outstanding segments remain, restart the timer; otherwise stop it.
@@ -232,10 +403,57 @@ void TCPSender::receive(const TCPReceiverMessage& msg) {
   }
 }
 
+/* ---------------- set_peer_sack_permitted ---------------- */
+void TCPSender::set_peer_sack_permitted(bool permitted) {
+  peer_syn_received_ = true;
+  peer_sack_permitted_ = permitted;
+}
+
+/* ---------------- set_peer_window_scale ----------------
+   Window scaling is in use only if both SYNs offered it (RFC 7323 section 2.2).
+*/
+void TCPSender::set_peer_window_scale(uint8_t shift) {
+  peer_offers_window_scale_ = true;
+  if (!config_.window_scaling) return;
+  peer_window_shift_ = std::min(shift, TCPConfig::MAX_WINDOW_SCALE);
+}
+
+/* ---------------- set_peer_mss ----------------
+   (The congestion controller and the pacing burst count in segments, so they start over with the new size;
+   this happens with the peer's SYN, before there's anything for them to forget.)
+*/
+void TCPSender::set_peer_mss(uint64_t peer_mss) {
+  if (config_.mtu == 0) return;
+  const uint64_t mss = std::clamp<uint64_t>(peer_mss, 1, config_.mss());
+  if (mss == mss_) return;
+  mss_ = mss;
+  cc_ = CongestionControl::make(config_.congestion_control, mss_);
+  pacing_budget_ = 2 * static_cast<int64_t>(mss_);
+}
+
+/* ---------------- set_option_space ---------------- */
+void TCPSender::set_option_space(uint64_t bytes) {
+  option_space_ = bytes;
+}
+
 /* ---------------- tick ----------------
    Time has passed; check retransmission timer and retransmit earliest outstanding segment if necessary.
 */
 void TCPSender::tick(uint64_t ms_since_last_tick, const TransmitFunction& transmit) {
+  now_ms_ += ms_since_last_tick;
+  check_timer(ms_since_last_tick, transmit);
+
+  // A paced controller earns more budget with time; send whatever it now allows.
+  const uint64_t pacing_rate = cc_->pacing_rate();
+  if (pacing_rate > 0) {
+    const auto refill = static_cast<int64_t>(pacing_rate * ms_since_last_tick / 1000);
+    const auto max_budget = std::max<int64_t>(refill, 2 * static_cast<int64_t>(mss_));
+    pacing_budget_ = std::min(pacing_budget_ + refill, max_budget);
+    push(transmit);
+  }
+}
+
+void TCPSender::check_timer(uint64_t ms_since_last_tick, const TransmitFunction& transmit) {
   if (!timer_running_) return;
 
   time_since_timer_start_ms_ += ms_since_last_tick;
@@ -244,14 +462,35 @@ void TCPSender::tick(uint64_t ms_since_last_tick, const TransmitFunction& transm
 
   // timer expired
   if (!outstanding_.empty()) {
+    // anything resent before may have been lost too, and the receiver may have discarded what it SACKed
+    // (RFC 2018 section 8), so the scoreboard starts over from the SACK blocks in later acks
+    for (auto &os : outstanding_) {
+      os.repaired = false;
+      os.sacked = false;
+    }
+    sacked_bytes_ = 0;
+    highest_sacked_abs_ = 0;
+
     Outstanding &os = outstanding_.front();
     // retransmit earliest outstanding
     transmit(os.msg);
+    os.retransmitted = true;
+    os.repaired = true;
 
-    // Apply exponential backoff only if the window is nonzero (per lab text)
+    // Apply exponential backoff only if the window is nonzero (per lab text);
+    // a zero-window probe going unanswered says nothing about congestion either.
     if (window_size_ > 0) {
       ++consecutive_retransmissions_;
       current_RTO_ms_ *= 2;
+      if (config_.adaptive_rto) current_RTO_ms_ = std::min(current_RTO_ms_, config_.rto_max_ms);
+      cc_->on_rto(now_ms_, next_seqno_abs_ - last_acked_abs_);
+
+      // a timeout ends any fast recovery, and starts afresh from the oldest segment
+      dup_acks_ = 0;
+      in_recovery_ = false;
+      recovery_inflation_ = 0;
+      retransmit_pending_ = false;
+      recover_ = next_seqno_abs_;
     }
 
     // restart timer counting from zero
@@ -261,4 +500,4 @@ void TCPSender::tick(uint64_t ms_since_last_tick, const TransmitFunction& transm
     // nothing outstanding, stop timer
     stop_timer();
   }
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include "wrapping_integers.hh"
@@ -9,18 +10,31 @@
 #include <cstdint>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
 
 class TCPSender
 {
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
-  TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
-    : input_( std::move( input ) ), isn_( isn ), initial_RTO_ms_( initial_RTO_ms ),
-      current_RTO_ms_( initial_RTO_ms ),
+  /* (Its other options -- congestion control, adaptive RTO, fast retransmit, SACK, window scaling -- come
+     from `config`, and are all off by default.) */
+  TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms, const TCPConfig& config = {} )
+    : input_( std::move( input ) ), isn_( isn ), config_( config ), mss_( config.mss() ), option_space_( 0 ),
+      initial_RTO_ms_( initial_RTO_ms ),
+      current_RTO_ms_( initial_RTO_ms ), rtt_stats_(),
       next_seqno_abs_( 0 ), last_acked_abs_( 0 ),
-      window_size_( 1 ), outstanding_(), timer_running_( false ),
+      window_size_( 1 ), peer_window_shift_( 0 ), peer_syn_received_( false ), peer_sack_permitted_( false ),
+      peer_offers_window_scale_( false ),
+      outstanding_(), in_flight_( 0 ), timer_running_( false ),
       time_since_timer_start_ms_( 0 ), consecutive_retransmissions_( 0 ),
-      syn_sent_( false ), fin_sent_( false )
+      syn_sent_( false ), fin_sent_( false ),
+      dup_acks_( 0 ), in_recovery_( false ), recover_( 0 ), recovery_inflation_( 0 ),
+      retransmit_pending_( false ), fast_retransmissions_( 0 ), sacked_bytes_( 0 ), highest_sacked_abs_( 0 ),
+      peer_sacks_( false ),
+      cc_( CongestionControl::make( config.congestion_control, mss_ ) ), now_ms_( 0 ),
+      pacing_budget_( 2 * static_cast<int64_t>( mss_ ) )
   {}
 
   /* Generate an empty TCPSenderMessage */
@@ -29,6 +43,22 @@ public:
   /* Receive and process a TCPReceiverMessage from the peer's receiver */
   void receive( const TCPReceiverMessage& msg );
 
+  /* The peer's SYN arrived, and did or didn't permit SACK (RFC 2018). Our own SYN, if it hasn't gone out yet,
+     is then a SYN-ACK, and only offers the options the peer's SYN did. */
+  void set_peer_sack_permitted( bool permitted );
+
+  /* The peer's SYN offered window scaling (RFC 7323). If this sender offered it too, the windows the peer
+     advertises after its SYN count in units of 2^shift. */
+  void set_peer_window_scale( uint8_t shift );
+
+  /* The peer's SYN advertised the largest payload it can receive (or TCPConfig::DEFAULT_PEER_MSS, if it didn't
+     say). Unless the config leaves `mtu` unset, payloads are limited to the smaller of that and our own MSS. */
+  void set_peer_mss( uint64_t peer_mss );
+
+  /* The segments about to be sent will carry this many bytes of options (e.g. SACK blocks) that aren't the
+     sender's own. Options count against the MSS (RFC 6691), so new payloads are shortened to leave room. */
+  void set_option_space( uint64_t bytes );
+
   /* Type of the `transmit` function that the push and tick methods can use to send messages */
   using TransmitFunction = std::function<void( const TCPSenderMessage& )>;
 
@@ -41,6 +71,22 @@ public:
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // For testing: how many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // For testing: how many consecutive retransmissions have happened?
+  const CongestionControl& congestion_control() const { return *cc_; }
+  uint64_t mss() const { return mss_; } // largest payload to send in one segment
+
+  /* Round-trip time measurements, from acks of segments that were only sent once (Karn's rule) */
+  struct RTTStats {
+    uint64_t samples {};
+    uint64_t latest_ms {};
+    uint64_t min_ms {};
+    double smoothed_ms {};  // SRTT
+    double variation_ms {}; // RTTVAR
+    uint64_t estimated_RTO_ms {}; // SRTT + 4 * RTTVAR, within the policy's bounds
+  };
+  const RTTStats& rtt_stats() const { return rtt_stats_; }
+  uint64_t current_RTO_ms() const { return current_RTO_ms_; } // including any backoff
+  uint64_t fast_retransmissions() const { return fast_retransmissions_; } // how many, over the connection
+  uint64_t sacked_bytes() const { return sacked_bytes_; } // sequence numbers in flight that the peer has SACKed
   const Writer& writer() const { return input_.writer(); }
   const Reader& reader() const { return input_.reader(); }
   Writer& writer() { return input_.writer(); }
@@ -51,17 +97,31 @@ private:
   struct Outstanding {
     TCPSenderMessage msg {};
     uint64_t first_seqno_abs {}; // absolute seqno of the first sequence number of this segment
-    uint64_t time_sent_ms {};    // not used by tests, but kept for bookkeeping
-
-    Outstanding() : msg(), first_seqno_abs(0), time_sent_ms(0) {}
+    uint64_t time_sent_ms {};    // sender's clock when it was (first) sent
+    uint64_t delivered_at_send {}; // last_acked_abs_ when it was sent, for delivery-rate samples
+    bool retransmitted {};       // if so, its ack can't be timed (Karn's rule)
+    bool sacked {};              // the receiver holds it, so it needn't be resent
+    bool repaired {};            // resent since the latest loss was detected
+
+    Outstanding()
+      : msg(), first_seqno_abs(0), time_sent_ms(0), delivered_at_send(0), retransmitted(false), sacked(false),
+        repaired(false) {}
   };
 
   // helpers
   void start_timer();
   void stop_timer();
   void restart_timer();
+  void check_timer(uint64_t ms_since_last_tick, const TransmitFunction& transmit);
   void track_outstanding(const TCPSenderMessage &m, uint64_t first_seqno_abs);
-  void remove_fully_acked(uint64_t ack_abs);
+  void remove_fully_acked(uint64_t ack_abs, AckSample &sample);
+  void update_rtt(uint64_t rtt_ms);
+  void on_duplicate_ack();
+  bool update_scoreboard(const std::vector<TCPReceiverMessage::SackBlock> &blocks);
+  void retransmit_holes(const TransmitFunction& transmit);
+  void resend(Outstanding &os, const TransmitFunction& transmit);
+  // the peer sends SACK blocks, so the scoreboard (rather than window inflation) tracks what left the network
+  bool sack_in_use() const { return peer_sacks_; }
 
   // stream
   ByteStream input_;
@@ -69,9 +129,15 @@ private:
   // wrapping / sequence
   Wrap32 isn_;
 
+  // options
+  TCPConfig config_;
+  uint64_t mss_;
+  uint64_t option_space_; // how much of the MSS the options alongside a new payload will take
+
   // retransmission timeout state
   uint64_t initial_RTO_ms_;
   uint64_t current_RTO_ms_;
+  RTTStats rtt_stats_;
 
   // absolute sequence numbers:
   // next_seqno_abs_ is the absolute sequence number that will be assigned to the next sequence-space byte (or SYN if SYN not yet sent).
@@ -79,11 +145,19 @@ private:
   // highest ack we've seen (absolute number of next seq expected by receiver)
   uint64_t last_acked_abs_;
 
-  // receiver window (as last advertised)
-  uint16_t window_size_;
+  // receiver window (as last advertised, scaled)
+  uint64_t window_size_;
+  uint8_t peer_window_shift_;
+
+  // what the peer's SYN offered, once it has arrived
+  bool peer_syn_received_;
+  bool peer_sack_permitted_;
+  bool peer_offers_window_scale_;
 
   // outstanding segments (oldest first)
   std::deque<Outstanding> outstanding_;
+  // total sequence_length() of outstanding_, kept up to date as segments are sent and acked
+  uint64_t in_flight_;
 
   // retransmission timer
   bool timer_running_;
@@ -95,4 +169,24 @@ private:
   // flags about SYN/FIN
   bool syn_sent_;
   bool fin_sent_;
+
+  // fast retransmit and recovery (RFC 5681, RFC 6582)
+  uint64_t dup_acks_;           // consecutive duplicate acks
+  bool in_recovery_;
+  uint64_t recover_;            // next_seqno_abs_ when the last recovery (or timeout) began
+  uint64_t recovery_inflation_; // added to the congestion window for segments that have left the network
+  bool retransmit_pending_;     // resend the holes (or else the oldest outstanding segment) at the next push()
+  uint64_t fast_retransmissions_;
+
+  // SACK scoreboard (RFC 2018, RFC 6675), kept in the `sacked` flags of outstanding_
+  uint64_t sacked_bytes_;       // total sequence_length() of SACKed outstanding segments
+  uint64_t highest_sacked_abs_; // one past the highest SACKed sequence number; unSACKed segments below are holes
+  bool peer_sacks_;             // the peer has sent SACK blocks (even if a timeout has since cleared them)
+
+  // congestion control
+  std::unique_ptr<CongestionControl> cc_;
+  // total time passed to tick()
+  uint64_t now_ms_;
+  // bytes a paced controller still lets us send before the next tick (may go negative by part of a segment)
+  int64_t pacing_budget_;
 };
\ No newline at end of file
@@ -1,45 +1,24 @@
 #include "wrapping_integers.hh"
-#include "debug.hh"
+
+#include <stdexcept>
 
 using namespace std;
 
-Wrap32 Wrap32::wrap(uint64_t n, Wrap32 zero_point) {
-    // Convert absolute sequence number n to  32-bit wrapped sequence number
-    uint32_t wrapped_value = static_cast<uint32_t>(n + zero_point.raw_value_);
-    return Wrap32{wrapped_value};
-}
+void Wrap32::unwrap_batch( span<const Wrap32> seqnos, Wrap32 zero_point, uint64_t checkpoint, span<uint64_t> out )
+{
+  if ( out.size() < seqnos.size() ) {
+    throw runtime_error( "Wrap32::unwrap_batch: output span is too short" );
+  }
 
-uint64_t Wrap32::unwrap(Wrap32 zero_point, uint64_t checkpoint) const {
-    // Calculate the offset from zero_point
-    uint32_t offset = raw_value_ - zero_point.raw_value_;
-    
-    // Start with the simple case where we assume the absolute seqno is just the offset
-    uint64_t result = offset;
-    
-    // If checkpoint is large enough, we need to find the multiple of 2^32 that gets us closest
-    if (checkpoint > (1ULL << 31)) {
-        // Calculate the base (multiple of 2^32) that aligns with checkpoint
-        uint64_t base = (checkpoint - offset) & ~0xFFFFFFFFULL;
-        result = base + offset;
-        
-        // Consider the candidate one cycle before and after
-        uint64_t candidate1 = result;
-        uint64_t candidate2 = result + (1ULL << 32);
-        uint64_t candidate0 = result < (1ULL << 32) ? 0 : result - (1ULL << 32);
-        
-        // Find which candidate is closest to checkpoint
-        uint64_t diff0 = candidate0 > checkpoint ? candidate0 - checkpoint : checkpoint - candidate0;
-        uint64_t diff1 = candidate1 > checkpoint ? candidate1 - checkpoint : checkpoint - candidate1;
-        uint64_t diff2 = candidate2 > checkpoint ? candidate2 - checkpoint : checkpoint - candidate2;
-        
-        if (diff0 <= diff1 && diff0 <= diff2) {
-            result = candidate0;
-        } else if (diff2 <= diff1 && diff2 <= diff0) {
-            result = candidate2;
-        } else {
-            result = candidate1;
-        }
+  // unwrap() has no branches, so the fixed-size inner loop vectorizes (even at -O2's cheapest cost model)
+  constexpr size_t block = 8;
+  size_t i = 0;
+  for ( ; i + block <= seqnos.size(); i += block ) {
+    for ( size_t j = i; j < i + block; ++j ) {
+      out[j] = seqnos[j].unwrap( zero_point, checkpoint );
     }
-    
-    return result;
+  }
+  for ( ; i < seqnos.size(); ++i ) {
+    out[i] = seqnos[i].unwrap( zero_point, checkpoint );
+  }
 }
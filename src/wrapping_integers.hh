@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 
 /*
  * The Wrap32 type represents a 32-bit unsigned integer that:
@@ -11,10 +12,13 @@
 class Wrap32
 {
 public:
-  explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
+  constexpr explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
 
   /* Construct a Wrap32 given an absolute sequence number n and the zero point. */
-  static Wrap32 wrap( uint64_t n, Wrap32 zero_point );
+  static constexpr Wrap32 wrap( uint64_t n, Wrap32 zero_point )
+  {
+    return Wrap32 { static_cast<uint32_t>( n ) + zero_point.raw_value_ };
+  }
 
   /*
    * The unwrap method returns an absolute sequence number that wraps to this Wrap32, given the zero point
@@ -23,11 +27,46 @@ public:
    * There are many possible absolute sequence numbers that all wrap to the same Wrap32.
    * The unwrap method should return the one that is closest to the checkpoint.
    */
-  uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const;
+  constexpr uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const
+  {
+    // The signed 32-bit distance from the checkpoint's wrapped value picks the closest candidate (the lower
+    // one, on a tie), unless that candidate would be negative, in which case the next one up is the answer.
+    // Every comparison is 32-bit and there are no branches, so that unwrap_batch can vectorize.
+    const auto distance = static_cast<int32_t>( raw_value_ - wrap( checkpoint, zero_point ).raw_value_ );
+    const uint32_t low_checkpoint = checkpoint > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>( checkpoint );
+    const uint32_t magnitude = 0U - static_cast<uint32_t>( distance ); // |distance|, when it is negative
+    const uint32_t below_zero
+      = static_cast<uint32_t>( distance < 0 ) & static_cast<uint32_t>( magnitude > low_checkpoint );
+    return checkpoint + static_cast<uint64_t>( int64_t { distance } ) + ( uint64_t { below_zero } << 32 );
+  }
 
-  Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
-  bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
+  /*
+   * Unwrap a burst of sequence numbers against the same zero point and checkpoint: out[i] is
+   * seqnos[i].unwrap( zero_point, checkpoint ). `out` must be at least as long as `seqnos`.
+   */
+  static void unwrap_batch( std::span<const Wrap32> seqnos,
+                            Wrap32 zero_point,
+                            uint64_t checkpoint,
+                            std::span<uint64_t> out );
+
+  constexpr Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
+  constexpr Wrap32 operator-( uint32_t n ) const { return Wrap32 { raw_value_ - n }; }
+  constexpr bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
+
+  /*
+   * Serial-number arithmetic (RFC 1982), which needs no zero point or checkpoint.
+   *
+   * a - b counts forward from b to a, modulo 2^32. a.distance( b ) is the same as a signed number: negative
+   * if a is behind b. The comparisons follow it, so a < b when b is less than 2^31 ahead of a. (Two values
+   * exactly 2^31 apart are each "less" than the other; RFC 1982 leaves that case undefined.)
+   */
+  constexpr uint32_t operator-( Wrap32 other ) const { return raw_value_ - other.raw_value_; }
+  constexpr int32_t distance( Wrap32 other ) const { return static_cast<int32_t>( raw_value_ - other.raw_value_ ); }
+  constexpr bool operator<( Wrap32 other ) const { return distance( other ) < 0; }
+  constexpr bool operator<=( Wrap32 other ) const { return distance( other ) <= 0; }
+  constexpr bool operator>( Wrap32 other ) const { return other < *this; }
+  constexpr bool operator>=( Wrap32 other ) const { return other <= *this; }
 
 protected:
   uint32_t raw_value_ {};
-};
\ No newline at end of file
+};
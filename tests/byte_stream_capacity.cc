@@ -96,6 +96,41 @@ int main()
       test.execute( BytesBuffered { 1 } );
     }
 
+    {
+      ByteStreamTestHarness test { "peek_iov across the end of the buffer", 8 };
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 5 } );
+      test.execute( Push { "ghijkl" } );
+      test.execute( PeekIov { 100, { "fgh", "ijkl" } } );
+      test.execute( PeekIov { 5, { "fgh", "ij" } } );
+      test.execute( PeekIov { 2, { "fg" } } );
+      test.execute( PeekIov { 0, {} } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekIov { 100, { "ijkl" } } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekIov { 100, {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "reserve/commit in place", 8 };
+      test.execute( ReserveCommit { 100, "abcdef" } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( AvailableCapacity { 2 } );
+      test.execute( Pop { 5 } );
+      test.execute( ReserveCommit { 100, "ghijklmno" } ); // only "gh" fits before the end of the buffer
+      test.execute( BytesPushed { 8 } );
+      test.execute( ReserveCommit { 100, "ijklmno" } );
+      test.execute( BytesPushed { 13 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( ReserveCommit { 100, "p" } );
+      test.execute( BytesPushed { 13 } );
+      test.execute( Peek { "fghijklm" } );
+      test.execute( Pop { 1 } );
+      test.execute( ReserveCommit { 100, "" } );
+      test.execute( BytesBuffered { 7 } );
+      test.execute( Peek { "ghijklm" } );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -0,0 +1,135 @@
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    const auto chunked = ByteStream::Storage::Chunked;
+
+    {
+      ByteStreamTestHarness test { "chunked: write-write-pop-pop", 15, chunked };
+
+      test.execute( Push { string( 300, 'a' ) } );
+      test.execute( BytesPushed { 15 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekOnce { string( 15, 'a' ) } );
+      test.execute( Pop { 10 } );
+      test.execute( PeekOnce { string( 5, 'a' ) } );
+      test.execute( Push { "bcdefghijklmnop" } );
+      test.execute( BytesBuffered { 15 } );
+      test.execute( Peek { "aaaaabcdefghijk" } );
+      test.execute( Pop { 7 } );
+      test.execute( PeekOnce { "defghijk" } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "defghijk" } );
+      test.execute( IsFinished { true } );
+      test.execute( BytesPopped { 25 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked: large pushes stay whole", 4096, chunked };
+
+      const string first( 1000, 'x' );
+      const string second( 1000, 'y' );
+      test.execute( Push { first } );
+      test.execute( Push { second } );
+      test.execute( PeekOnce { first } );
+      test.execute( Pop { 999 } );
+      test.execute( PeekOnce { "x" } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekOnce { second.substr( 1 ) } );
+      test.execute( BytesBuffered { 999 } );
+      test.execute( AvailableCapacity { 4096 - 999 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked: peek_iov spans chunks", 4096, chunked };
+
+      const string first( 500, 'x' );
+      const string second( 400, 'y' );
+      const string third( 300, 'z' );
+      test.execute( Push { first } );
+      test.execute( Push { second } );
+      test.execute( Push { third } );
+      test.execute( PeekIov { 4096, { first, second, third } } );
+      test.execute( Pop { 450 } );
+      test.execute( PeekIov { 4096, { first.substr( 450 ), second, third } } );
+      test.execute( PeekIov { 500, { first.substr( 450 ), second, third.substr( 0, 50 ) } } );
+      test.execute( PeekIov { 250, { first.substr( 450 ), second.substr( 0, 200 ) } } );
+      test.execute( PeekIov { 50, { first.substr( 450 ) } } );
+      test.execute( Pop { 800 } );
+      test.execute( PeekIov { 4096, {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked: reserve/commit", 4096, chunked };
+
+      const string big( 2000, 'q' );
+      test.execute( ReserveCommit { 10000, big } );
+      test.execute( PeekOnce { big } );
+      test.execute( ReserveCommit { 100, "abc" } );
+      test.execute( ReserveCommit { 1000, string( 300, 'r' ) } );
+      test.execute( PeekIov { 4096, { big + "abc", string( 300, 'r' ) } } );
+      test.execute( BytesPushed { 2303 } );
+      test.execute( ReserveCommit { 10000, string( 5000, 's' ) } );
+      test.execute( BytesBuffered { 4096 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Pop { 4000 } );
+      test.execute( Peek { string( 96, 's' ) } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked: small pushes coalesce", 100, chunked };
+
+      test.execute( Push { "" } );
+      test.execute( Peek { "" } );
+      test.execute( Push { "ab" } );
+      test.execute( Push { "cd" } );
+      test.execute( Push { "ef" } );
+      test.execute( PeekOnce { "abcdef" } );
+      test.execute( Pop { 6 } );
+      test.execute( BufferEmpty { true } );
+      test.execute( Push { "gh" } );
+      test.execute( PeekOnce { "gh" } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "gh" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      // Pushed strings are adopted, except a mostly-empty buffer (e.g. a read buffer holding one segment),
+      // whose bytes are copied out so the queue doesn't hold on to the whole allocation.
+      ByteStream stream { 65536, chunked };
+      string sparse;
+      sparse.reserve( 16384 );
+      sparse.assign( 1000, 'x' );
+      const char* sparse_data = sparse.data();
+      string full( 1000, 'y' );
+      const char* full_data = full.data();
+      stream.writer().push( move( sparse ) );
+      stream.writer().push( move( full ) );
+
+      const auto views = stream.reader().peek_iov();
+      if ( views.size() != 2 or views[0] != string( 1000, 'x' ) or views[1] != string( 1000, 'y' ) ) {
+        throw runtime_error( "chunked: wrong contents after pushing a mostly-empty buffer" );
+      }
+      if ( views[0].data() == sparse_data ) {
+        throw runtime_error( "chunked: a mostly-empty buffer was queued whole" );
+      }
+      if ( views[1].data() != full_data ) {
+        throw runtime_error( "chunked: a full buffer was copied rather than adopted" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
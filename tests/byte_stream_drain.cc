@@ -0,0 +1,79 @@
+#include "byte_stream.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+void check( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "drain_to: " + what );
+  }
+}
+
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_CLOEXEC ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+string read_exactly( FileDescriptor& fd, size_t len )
+{
+  string ret;
+  while ( ret.size() < len ) {
+    string buf( len - ret.size(), 0 );
+    fd.read( buf );
+    check( not buf.empty(), "pipe closed early" );
+    ret += buf;
+  }
+  return ret;
+}
+
+void drain( ByteStream::Storage storage )
+{
+  auto [read_end, write_end] = make_pipe();
+
+  ByteStream stream { 16, storage };
+  check( stream.reader().drain_to( write_end ) == 0, "draining an empty stream" );
+  check( write_end.write_count() == 0, "draining an empty stream should not write" );
+
+  stream.writer().push( "0123456789" );
+  stream.reader().pop( 8 );
+  stream.writer().push( "abcdefghijklmn" ); // wraps around the end of the ring storage
+
+  check( stream.reader().drain_to( write_end, 5 ) == 5, "drain with a limit" );
+  check( stream.reader().bytes_buffered() == 11 and stream.reader().bytes_popped() == 13, "counters after drain" );
+  check( read_exactly( read_end, 5 ) == "89abc", "bytes drained with a limit" );
+
+  check( stream.reader().drain_to( write_end ) == 11, "drain everything" );
+  check( stream.reader().bytes_buffered() == 0, "stream should be empty" );
+  check( read_exactly( read_end, 11 ) == "defghijklmn", "bytes drained" );
+  check( write_end.write_count() == 2, "each drain should be a single write" );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    drain( ByteStream::Storage::Ring );
+    drain( ByteStream::Storage::Chunked );
+    drain( ByteStream::Storage::Spill );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
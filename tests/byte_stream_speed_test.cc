@@ -1,33 +1,116 @@
 #include "byte_stream.hh"
+#include "spsc_byte_stream.hh"
+#include "speed_test_common.hh"
 
-#include <chrono>
+#include <array>
 #include <cstddef>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <queue>
 #include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 using namespace std;
-using namespace std::chrono;
-
-double speed_test( fstream& debug_output,
-                   const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
-                   const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
-                   const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
-                   const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
-                   const size_t read_size )  // NOLINT(bugprone-easily-swappable-parameters)
+
+namespace {
+
+// If set (on the command line), the throughput every configuration must reach, instead of its own threshold
+optional<double> min_gigabits_per_second; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// What one kind of configuration must achieve to pass. The floors sit well below what a development machine
+// measures, so that they catch regressions rather than noise; the allocation ceilings are tight, since the
+// allocation counts don't depend on the machine.
+struct Threshold
 {
-  // Generate the data to be written
-  const string data = [&random_seed, &input_len] {
-    default_random_engine rd { random_seed };
-    uniform_int_distribution<char> ud;
-    string ret;
-    for ( size_t i = 0; i < input_len; ++i ) {
-      ret += ud( rd );
+  string_view scenario;
+  string_view storage;
+  size_t write_size; // 0 matches any write size
+  double min_gbit_per_s;
+  double max_allocs_per_mb;
+};
+
+// The first entry that matches a record applies.
+constexpr array<Threshold, 5> thresholds { {
+  { "single_thread", "ring", 16, 0.2, 1 },       // the ring never allocates...
+  { "single_thread", "ring", 0, 1, 1 },          // ...whatever the write size
+  { "single_thread", "chunked", 16, 0.2, 5000 }, // about one allocation per 256 coalesced bytes
+  { "single_thread", "chunked", 0, 1, 100 },     // adopted pushes: only the chunk queue's own blocks
+  { "two_threads", "spsc", 0, 1, 1 },            // just the producer thread
+} };
+
+string random_data( size_t input_len, size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  ret.reserve( input_len );
+  for ( size_t i = 0; i < input_len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+string storage_name( ByteStream::Storage storage )
+{
+  return storage == ByteStream::Storage::Chunked ? "chunked" : "ring";
+}
+
+string describe( const SpeedTestRecord& record )
+{
+  return "ByteStream (" + record.label( "scenario" ) + ", " + record.label( "storage" )
+         + ", capacity=" + to_string( static_cast<uint64_t>( record.number( "capacity" ) ) )
+         + ", write_size=" + to_string( static_cast<uint64_t>( record.number( "write_size" ) ) )
+         + ", read_size=" + to_string( static_cast<uint64_t>( record.number( "read_size" ) ) )
+         + ", data_size=" + to_string( static_cast<uint64_t>( record.number( "data_size" ) ) ) + ")";
+}
+
+const Threshold& threshold_for( const SpeedTestRecord& record )
+{
+  const auto write_size = static_cast<size_t>( record.number( "write_size" ) );
+  for ( const auto& threshold : thresholds ) {
+    if ( record.label( "scenario" ) == threshold.scenario and record.label( "storage" ) == threshold.storage
+         and ( threshold.write_size == 0 or threshold.write_size == write_size ) ) {
+      return threshold;
     }
-    return ret;
-  }();
+  }
+  throw runtime_error( "no threshold for " + describe( record ) );
+}
+
+// Check every record against its configuration's threshold, and report all that miss at once.
+void check_thresholds( const vector<SpeedTestRecord>& records )
+{
+  string failures;
+  for ( const auto& record : records ) {
+    const Threshold& threshold = threshold_for( record );
+    const double min_gbps = min_gigabits_per_second.value_or( threshold.min_gbit_per_s );
+    if ( record.number( "gbit_per_s" ) < min_gbps ) {
+      failures += "\n  " + describe( record ) + " reached " + to_string( record.number( "gbit_per_s" ) )
+                  + " Gbit/s, below the minimum of " + to_string( min_gbps );
+    }
+    if ( record.number( "allocs_per_mb" ) > threshold.max_allocs_per_mb ) {
+      failures += "\n  " + describe( record ) + " made " + to_string( record.number( "allocs_per_mb" ) )
+                  + " allocations/MB, above the maximum of " + to_string( threshold.max_allocs_per_mb );
+    }
+  }
+  if ( not failures.empty() ) {
+    throw runtime_error( "regression thresholds not met:" + failures );
+  }
+}
+
+SpeedTestRecord speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t read_size,   // NOLINT(bugprone-easily-swappable-parameters)
+                            const ByteStream::Storage storage )
+{
+  // Generate the data to be written
+  const string data = random_data( input_len, random_seed );
 
   // Split the data into segments before writing
   queue<string> split_data;
@@ -35,11 +118,12 @@ double speed_test( fstream& debug_output,
     split_data.emplace( data.substr( i, write_size ) );
   }
 
-  ByteStream bs { capacity };
+  ByteStream bs { capacity, storage };
   string output_data;
   output_data.reserve( data.size() );
+  uint64_t operations = 0;
 
-  const auto start_time = steady_clock::now();
+  const SpeedTestTimer timer;
   while ( not bs.reader().is_finished() ) {
     if ( split_data.empty() ) {
       if ( not bs.writer().is_closed() ) {
@@ -49,6 +133,7 @@ double speed_test( fstream& debug_output,
       if ( split_data.front().size() <= bs.writer().available_capacity() ) {
         bs.writer().push( move( split_data.front() ) );
         split_data.pop();
+        ++operations;
       }
     }
 
@@ -59,49 +144,146 @@ double speed_test( fstream& debug_output,
       }
       output_data += peeked;
       bs.reader().pop( peeked.size() );
+      ++operations;
     }
   }
-
-  const auto stop_time = steady_clock::now();
+  const double seconds = timer.seconds();
+  const uint64_t allocations = timer.allocations();
 
   if ( data != output_data ) {
     throw runtime_error( "Mismatch between data written and read" );
   }
 
-  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
-  auto bytes_per_second = static_cast<double>( input_len ) / test_duration.count();
-  auto bits_per_second = 8 * bytes_per_second;
-  auto gigabits_per_second = bits_per_second / 1e9;
+  const double gbps = gigabits_per_second( input_len, seconds );
+  return SpeedTestRecord {}
+    .label( "scenario", "single_thread" )
+    .label( "storage", storage_name( storage ) )
+    .number( "capacity", static_cast<double>( capacity ) )
+    .number( "write_size", static_cast<double>( write_size ) )
+    .number( "read_size", static_cast<double>( read_size ) )
+    .number( "data_size", static_cast<double>( input_len ) )
+    .number( "gbit_per_s", gbps )
+    .number( "ns_per_op", seconds * 1e9 / static_cast<double>( operations ) )
+    .number( "allocs_per_mb", static_cast<double>( allocations ) * 1e6 / static_cast<double>( input_len ) );
+}
+
+// A producer thread pushes while the calling thread pops, through an SPSCByteStream.
+SpeedTestRecord two_thread_speed_test( const size_t input_len, // NOLINT(bugprone-easily-swappable-parameters)
+                                       const size_t capacity,  // NOLINT(bugprone-easily-swappable-parameters)
+                                       const size_t write_size,
+                                       const size_t read_size )
+{
+  const string data = random_data( input_len, 2718 );
+  SPSCByteStream bs { capacity };
+  string output_data;
+  output_data.reserve( data.size() );
+  uint64_t operations = 0;
 
-  cout << "ByteStream with capacity=" << capacity << ", write_size=" << write_size << ", read_size=" << read_size
-       << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+  const SpeedTestTimer timer;
+  thread producer { [&] {
+    string_view remaining = data;
+    while ( not remaining.empty() ) {
+      const uint64_t before = bs.bytes_pushed();
+      bs.push( remaining.substr( 0, write_size ) );
+      const uint64_t pushed = bs.bytes_pushed() - before;
+      if ( pushed == 0 ) {
+        this_thread::yield();
+      }
+      remaining.remove_prefix( pushed );
+    }
+    bs.close();
+  } };
 
-  auto read_s = to_string( read_size );
-  const string fill( 5 - read_s.size(), ' ' );
-  debug_output << "        ByteStream throughput (pop length " << read_s << "):" << fill << fixed
-               << setprecision( 2 ) << setw( 5 ) << gigabits_per_second << " Gbit/s\n";
+  while ( not bs.is_finished() ) {
+    const auto peeked = bs.peek().substr( 0, read_size );
+    if ( peeked.empty() ) {
+      this_thread::yield();
+      continue;
+    }
+    output_data += peeked;
+    bs.pop( peeked.size() );
+    ++operations;
+  }
+  producer.join();
+  const double seconds = timer.seconds();
+  const uint64_t allocations = timer.allocations();
 
-  if ( gigabits_per_second < 0.1 ) {
-    throw runtime_error( "ByteStream did not meet minimum speed of 0.1 Gbit/s" );
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (two threads)" );
   }
 
-  return gigabits_per_second;
+  const double gbps = gigabits_per_second( input_len, seconds );
+  return SpeedTestRecord {}
+    .label( "scenario", "two_threads" )
+    .label( "storage", "spsc" )
+    .number( "capacity", static_cast<double>( capacity ) )
+    .number( "write_size", static_cast<double>( write_size ) )
+    .number( "read_size", static_cast<double>( read_size ) )
+    .number( "data_size", static_cast<double>( input_len ) )
+    .number( "gbit_per_s", gbps )
+    .number( "ns_per_op", seconds * 1e9 / static_cast<double>( operations ) )
+    .number( "allocs_per_mb", static_cast<double>( allocations ) * 1e6 / static_cast<double>( input_len ) );
 }
 
-void program_body()
+void program_body( const string& json_path )
 {
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  speed_test( debug_output, 1e7, 32768, 789, 1500, 4096 );
-  speed_test( debug_output, 1e7, 32768, 789, 1500, 128 );
-  speed_test( debug_output, 1e7, 32768, 789, 1500, 32 );
+  vector<SpeedTestRecord> records;
+
+  // The headline configurations
+  for ( const size_t read_size : { 4096, 128, 32 } ) {
+    auto record = speed_test( 1e7, 32768, 789, 1500, read_size, ByteStream::Storage::Ring );
+    const double gbps = record.number( "gbit_per_s" );
+
+    cerr << "ByteStream with capacity=32768, write_size=1500, read_size=" << read_size << " reached " << fixed
+         << setprecision( 2 ) << gbps << " Gbit/s.\n";
+
+    auto read_s = to_string( read_size );
+    const string fill( 5 - read_s.size(), ' ' );
+    debug_output << "        ByteStream throughput (pop length " << read_s << "):" << fill << fixed
+                 << setprecision( 2 ) << setw( 5 ) << gbps << " Gbit/s\n";
+
+    records.push_back( move( record ) );
+  }
+
+  // The full matrix: storage x capacity x write size x read size x data size
+  for ( const auto storage : { ByteStream::Storage::Ring, ByteStream::Storage::Chunked } ) {
+    for ( const size_t capacity : { 4096, 65536 } ) {
+      for ( const size_t write_size : { 16, 1500 } ) {
+        for ( const size_t read_size : { 32, 1500, 65536 } ) {
+          for ( const size_t data_size : { 1 << 20, 1 << 23 } ) {
+            records.push_back( speed_test( data_size, capacity, 1234, write_size, read_size, storage ) );
+          }
+        }
+      }
+    }
+  }
+
+  // Producer and consumer on different threads
+  for ( const size_t capacity : { 4096, 65536 } ) {
+    records.push_back( two_thread_speed_test( 1 << 23, capacity, 1500, 65536 ) );
+  }
+
+  // Write the report even if a configuration regressed, so the numbers can be compared.
+  write_json( json_path, "byte_stream", records );
+  check_thresholds( records );
 }
 
-int main()
+} // namespace
+
+// usage: byte_stream_speed_test [JSON_OUTPUT_PATH [MIN_GBIT_PER_S]]
+// The JSON report goes to stdout unless a path is given. Each configuration must reach the throughput and stay
+// under the allocations of its entry in `thresholds`; MIN_GBIT_PER_S replaces every throughput floor.
+int main( int argc, char* argv[] )
 {
   try {
-    program_body();
+    const vector<string> args( argv + 1, argv + argc );
+    if ( args.size() > 1 ) {
+      min_gigabits_per_second = stod( args.at( 1 ) );
+    }
+    program_body( args.empty() ? string {} : args.at( 0 ) );
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -0,0 +1,116 @@
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// A spilling ByteStream with small extents, so a small mapping spans enough of them for the advice to kick in.
+class SmallExtentByteStream : public ByteStream
+{
+public:
+  SmallExtentByteStream( uint64_t capacity, uint64_t extent ) : ByteStream( capacity, Storage::Spill )
+  {
+    spill_extent_ = extent;
+  }
+};
+
+// Stream more than a full ring's worth of data through a mapping of many extents.
+void spill_many_extents()
+{
+  constexpr uint64_t capacity = uint64_t { 1 } << 22;
+  constexpr uint64_t piece_size = uint64_t { 1 } << 14;
+  constexpr uint64_t total = capacity + capacity / 2;
+
+  SmallExtentByteStream stream { capacity, uint64_t { 1 } << 18 };
+  string piece( piece_size, 0 );
+  uint64_t pushed = 0;
+  uint64_t popped = 0;
+
+  while ( popped < total ) {
+    // Fill to capacity, then read half of it back, so the head and tail both cross extent boundaries.
+    while ( pushed < total and stream.writer().available_capacity() >= piece_size ) {
+      piece.assign( piece_size, static_cast<char>( 'a' + pushed / piece_size % 26 ) );
+      stream.writer().push( piece );
+      pushed += piece_size;
+    }
+
+    const uint64_t target = min( pushed, popped + capacity / 2 );
+    while ( popped < target ) {
+      const string_view view = stream.reader().peek();
+      const uint64_t len = min<uint64_t>( view.size(), piece_size - popped % piece_size );
+      const char expected = static_cast<char>( 'a' + popped / piece_size % 26 );
+      if ( view.substr( 0, len ).find_first_not_of( expected ) != string_view::npos ) {
+        throw runtime_error( "spill: wrong bytes at offset " + to_string( popped ) );
+      }
+      stream.reader().pop( len );
+      popped += len;
+    }
+  }
+
+  if ( stream.reader().bytes_popped() != total or stream.reader().bytes_buffered() != 0 ) {
+    throw runtime_error( "spill: wrong counters after streaming" );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const auto spill = ByteStream::Storage::Spill;
+
+    {
+      ByteStreamTestHarness test { "spill: write-pop wraps around", 15, spill };
+
+      test.execute( Push { string( 300, 'a' ) } );
+      test.execute( BytesPushed { 15 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Pop { 10 } );
+      test.execute( Push { "bcdefghijklmnop" } );
+      test.execute( BytesBuffered { 15 } );
+      test.execute( Peek { "aaaaabcdefghijk" } );
+      test.execute( PeekIov { 15, { "aaaaab", "cdefghijk" } } );
+      test.execute( Pop { 7 } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "defghijk" } );
+      test.execute( IsFinished { true } );
+      test.execute( BytesPopped { 25 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "spill: reserve/commit", 8, spill };
+
+      test.execute( ReserveCommit { 5, "hello" } );
+      test.execute( Pop { 3 } );
+      test.execute( ReserveCommit { 10, "lo" } );
+      test.execute( ReserveCommit { 10, "abc" } ); // only "a" fits before the end of the storage
+      test.execute( BytesBuffered { 5 } );
+      test.execute( ReserveCommit { 10, "bc" } );
+      test.execute( BytesBuffered { 7 } );
+      test.execute( Peek { "loloabc" } );
+    }
+
+    {
+      // A copy gets its own temporary file.
+      ByteStream original { 64, spill };
+      original.writer().push( "original" );
+      ByteStream copy = original;
+      copy.writer().push( " and copy" );
+      original.reader().pop( 4 );
+      if ( original.reader().peek() != "inal" or copy.reader().peek() != "original and copy" ) {
+        throw runtime_error( "spill: copies should not share storage" );
+      }
+    }
+
+    spill_many_extents();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include "spsc_byte_stream.hh"
+
+#include "random.hh"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+string random_data( size_t len )
+{
+  auto rd = get_random_engine();
+  string ret( len, 0 );
+  generate( ret.begin(), ret.end(), [&] { return static_cast<char>( rd() ); } );
+  return ret;
+}
+
+void check( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "SPSCByteStream: " + what );
+  }
+}
+
+// Wait (with a generous timeout) for the given event to become readable.
+void wait_for( FileDescriptor& event )
+{
+  pollfd pfd { event.fd_num(), POLLIN, 0 };
+  if ( ::poll( &pfd, 1, 5000 ) != 1 ) {
+    throw runtime_error( "SPSCByteStream: timed out waiting for wakeup" );
+  }
+}
+
+void single_thread()
+{
+  SPSCByteStream bs { 10 };
+  check( bs.available_capacity() == 10, "initial available_capacity" );
+  check( bs.peek().empty(), "initial peek" );
+
+  bs.push( "hello, world" );
+  check( bs.bytes_pushed() == 10 and bs.bytes_buffered() == 10, "push beyond capacity" );
+  check( bs.peek() == "hello, wor", "peek after push" );
+
+  bs.pop( 7 );
+  bs.push( "ld!!" );
+  check( bs.bytes_buffered() == 7 and bs.bytes_popped() == 7, "counters after wrap" );
+
+  string got;
+  while ( bs.bytes_buffered() ) {
+    const auto view = bs.peek();
+    check( not view.empty(), "peek returned empty view with bytes buffered" );
+    got += view;
+    bs.pop( view.size() );
+  }
+  check( got == "world!!", "contents after wrap" );
+
+  check( not bs.is_finished(), "finished before close" );
+  bs.close();
+  check( bs.is_closed() and bs.is_finished(), "finished after close" );
+}
+
+// Writer and reader on separate threads, both polling the stream.
+void two_threads( bool wakeups, size_t capacity, size_t total_len )
+{
+  const string data = random_data( total_len );
+  SPSCByteStream bs { capacity, wakeups };
+
+  thread writer { [&] {
+    auto rd = get_random_engine();
+    size_t offset = 0;
+    while ( offset < data.size() ) {
+      if ( wakeups ) {
+        bs.clear_space_event();
+      }
+      const size_t before = bs.bytes_pushed();
+      bs.push( string_view { data }.substr( offset, 1 + rd() % ( 2 * capacity ) ) );
+      offset += bs.bytes_pushed() - before;
+      if ( bs.available_capacity() == 0 ) {
+        if ( wakeups ) {
+          wait_for( bs.space_event() );
+        } else {
+          this_thread::yield();
+        }
+      }
+    }
+    bs.close();
+  } };
+
+  string got;
+  got.reserve( data.size() );
+  auto rd = get_random_engine();
+  while ( not bs.is_finished() ) {
+    if ( wakeups ) {
+      bs.clear_data_event();
+    }
+    const auto view = bs.peek();
+    if ( view.empty() ) {
+      if ( bs.is_finished() ) {
+        break;
+      }
+      if ( wakeups ) {
+        wait_for( bs.data_event() );
+      } else {
+        this_thread::yield();
+      }
+      continue;
+    }
+    const auto len = min<size_t>( view.size(), 1 + rd() % capacity );
+    got += view.substr( 0, len );
+    bs.pop( len );
+  }
+
+  writer.join();
+  check( got == data, "data mismatch across threads" );
+  check( bs.bytes_pushed() == data.size() and bs.bytes_popped() == data.size(), "final counters" );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    single_thread();
+    two_threads( false, 1000, 1 << 20 );
+    two_threads( false, 7, 1 << 16 );
+    two_threads( true, 1000, 1 << 20 );
+    two_threads( true, 7, 1 << 16 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
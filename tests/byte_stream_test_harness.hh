@@ -4,7 +4,9 @@
 #include "common.hh"
 #include "helpers.hh"
 
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
                "Please add member variables to the ByteStream base, not the ByteStream Reader." );
@@ -19,6 +21,15 @@ public:
     : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
   {}
 
+  ByteStreamTestHarness( std::string test_name, uint64_t capacity, ByteStream::Storage storage )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity )
+                     + ( storage == ByteStream::Storage::Chunked ? ", chunked"
+                         : storage == ByteStream::Storage::Spill ? ", spill"
+                                                                 : ", ring" ),
+                   ByteStream { capacity, storage } )
+  {}
+
   size_t peek_size() { return object().reader().peek().size(); }
 };
 
@@ -34,6 +45,29 @@ struct Push : public Action<ByteStream>
   constexpr std::string obj() const override { return "Writer"; }
 };
 
+struct ReserveCommit : public Action<ByteStream>
+{
+  uint64_t max_len_;
+  std::string data_;
+
+  ReserveCommit( uint64_t max_len, std::string data ) : max_len_( max_len ), data_( move( data ) ) {}
+  std::string description() const override
+  {
+    return "reserve( " + std::to_string( max_len_ ) + " ), fill with \"" + pretty_print( data_ ) + "\", commit";
+  }
+  void execute( ByteStream& bs ) const override
+  {
+    auto space = bs.writer().reserve( max_len_ );
+    if ( space.size() > max_len_ ) {
+      throw ExpectationViolation { "reserve() returned more space than requested" };
+    }
+    const auto len = std::min<uint64_t>( space.size(), data_.size() );
+    std::copy_n( data_.begin(), len, space.begin() );
+    bs.writer().commit( data_.size() );
+  }
+  constexpr std::string obj() const override { return "Writer"; }
+};
+
 struct Close : public Action<ByteStream>
 {
   std::string description() const override { return "close"; }
@@ -119,6 +153,41 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekIov : public Expectation<ByteStream>
+{
+  uint64_t max_len_;
+  std::vector<std::string> output_;
+
+  PeekIov( uint64_t max_len, std::vector<std::string> output ) : max_len_( max_len ), output_( move( output ) ) {}
+
+  std::string description() const override
+  {
+    std::string ret = "peek_iov( " + std::to_string( max_len_ ) + " ) gives {";
+    for ( const auto& x : output_ ) {
+      ret += " \"" + pretty_print( x ) + "\"";
+    }
+    return ret + " }";
+  }
+
+  void execute( const ByteStream& bs ) const override
+  {
+    const auto views = bs.reader().peek_iov( max_len_ );
+    if ( views.size() != output_.size() ) {
+      throw ExpectationViolation { "peek_iov() should have returned " + std::to_string( output_.size() )
+                                   + " views, but instead returned " + std::to_string( views.size() ) };
+    }
+    for ( size_t i = 0; i < views.size(); ++i ) {
+      if ( views[i] != output_[i] ) {
+        throw ExpectationViolation { "peek_iov() view " + std::to_string( i ) + " should have been \""
+                                     + pretty_print( output_[i] ) + "\", but instead was \""
+                                     + pretty_print( views[i] ) + "\"" };
+      }
+    }
+  }
+
+  constexpr std::string obj() const override { return "Reader"; }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -0,0 +1,102 @@
+#include "byte_stream.hh"
+#include "chunk_pool.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void check( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "ChunkPool: " + what );
+  }
+}
+
+void acquire_and_release()
+{
+  const auto before = ChunkPool::stats();
+
+  string small = ChunkPool::acquire( 100 );
+  check( small.empty() and small.capacity() >= ChunkPool::kSizeClasses.front(), "small acquire" );
+  const char* small_data = small.data();
+  small = "some bytes";
+  ChunkPool::release( move( small ) );
+
+  string again = ChunkPool::acquire( 50 );
+  check( again.empty(), "recycled buffer should be empty" );
+  check( again.data() == small_data, "small buffer should have been reused" );
+
+  string big = ChunkPool::acquire( 20000 );
+  check( big.capacity() >= 20000, "big acquire" );
+  ChunkPool::release( move( big ) );
+
+  // A request for a small buffer can be served by a cached larger one.
+  ChunkPool::release( move( again ) );
+  string first = ChunkPool::acquire( 10 );
+  string second = ChunkPool::acquire( 10 );
+  check( first.capacity() >= 10 and second.capacity() >= 10, "acquire from larger class" );
+
+  // Buffers too small to be worth caching are not kept.
+  const auto released_before = ChunkPool::stats().released;
+  ChunkPool::release( string( 10, 'x' ) );
+  check( ChunkPool::stats().released == released_before, "tiny buffer should not be cached" );
+
+  const auto after = ChunkPool::stats();
+  check( after.hits - before.hits == 3, "expected three cache hits" );
+}
+
+void pooled_chunk_handle()
+{
+  const char* data = nullptr;
+  {
+    PooledChunk chunk { 1000 };
+    chunk->assign( 1000, 'z' );
+    data = chunk->data();
+  }
+  const PooledChunk reused { 1000 };
+  check( reused->data() == data and reused->empty(), "PooledChunk should return its buffer on destruction" );
+}
+
+// Chunks popped from a chunked ByteStream go back to the pool and are reused by later reservations.
+void byte_stream_recycles_chunks()
+{
+  ByteStream stream { 65536, ByteStream::Storage::Chunked };
+  Writer& writer = stream.writer();
+  Reader& reader = stream.reader();
+
+  for ( int round = 0; round < 4; ++round ) {
+    auto space = writer.reserve( 16384 );
+    check( space.size() == 16384, "reserve" );
+    writer.commit( space.size() );
+    reader.pop( reader.bytes_buffered() );
+  }
+
+  const auto before = ChunkPool::stats();
+  for ( int round = 0; round < 100; ++round ) {
+    writer.commit( writer.reserve( 16384 ).size() );
+    reader.pop( reader.bytes_buffered() );
+  }
+  const auto after = ChunkPool::stats();
+  check( after.misses == before.misses, "steady-state reserve/commit/pop should not allocate" );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    acquire_and_release();
+    pooled_chunk_handle();
+    byte_stream_recycles_chunks();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -130,6 +130,81 @@ int main()
       test.execute( ReadAll( "" ) );
       test.execute( IsFinished { true } );
     }
+
+    {
+      ReassemblerTestHarness test { "pending intervals", 64 };
+
+      test.execute( PendingIntervals { 4, {} } );
+      test.execute( Insert { "cd", 2 } );
+      test.execute( Insert { "ghi", 6 } );
+      test.execute( Insert { "x", 62 } );
+      test.execute( BytesPending( 6 ) );
+      test.execute( PendingIntervals { 4, { { 2, 4 }, { 6, 9 }, { 62, 63 } } } );
+      test.execute( PendingIntervals { 2, { { 2, 4 }, { 6, 9 } } } );
+      test.execute( Insert { "ef", 4 } );
+      test.execute( PendingIntervals { 4, { { 2, 9 }, { 62, 63 } } } );
+      test.execute( Insert { "ab", 0 } );
+      test.execute( BytesPushed( 9 ) );
+      test.execute( BytesPending( 1 ) );
+      test.execute( PendingIntervals { 4, { { 62, 63 } } } );
+      test.execute( ReadAll( "abcdefghi" ) );
+      test.execute( Insert { "yz", 63 } ); // wraps around the end of the window storage
+      test.execute( PendingIntervals { 4, { { 62, 65 } } } );
+      test.execute( BytesPending( 3 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "interval budget", 64, 2 };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( IntervalsPending( 2 ) );
+      test.execute( Insert { "f", 5 } ); // a third run: the farthest one goes
+      test.execute( IntervalsPending( 2 ) );
+      test.execute( IntervalsEvicted( 1 ) );
+      test.execute( BytesEvicted( 1 ) );
+      test.execute( PendingIntervals { 4, { { 1, 2 }, { 3, 4 } } } );
+      test.execute( Insert { "c", 2 } ); // joins the two runs
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( Insert { "hi", 7 } );
+      test.execute( Insert { "xyz", 40 } ); // evicts itself
+      test.execute( IntervalsEvicted( 2 ) );
+      test.execute( BytesEvicted( 4 ) );
+      test.execute( PendingIntervals { 4, { { 1, 4 }, { 7, 9 } } } );
+      test.execute( Insert { "efg", 4 } ); // fills the second gap
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( IntervalsPending( 0 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcdefghi" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "single-byte fragments", 4096, 16 };
+
+      for ( uint64_t i = 1; i < 4096; i += 2 ) {
+        test.execute( Insert { "x", i } );
+      }
+      test.execute( IntervalsPending( 16 ) );
+      test.execute( BytesPending( 16 ) );
+      test.execute( IntervalsEvicted( 2048 - 16 ) );
+      test.execute( Insert { string( 4096, 'x' ), 0 } );
+      test.execute( BytesPushed( 4096 ) );
+      test.execute( IntervalsPending( 0 ) );
+    }
+
+    {
+      // The window and bitmap live in a temporary file too, so a huge capacity costs nothing up front.
+      ReassemblerTestHarness test { "holes in a spilled window", uint64_t { 1 } << 33, ByteStream::Storage::Spill };
+
+      test.execute( Insert { "efg", 4 } );
+      test.execute( Insert { "xyz", 100000 } );
+      test.execute( PendingIntervals { 4, { { 4, 7 }, { 100000, 100003 } } } );
+      test.execute( Insert { "abcd", 0 } );
+      test.execute( BytesPushed( 7 ) );
+      test.execute( BytesPending( 3 ) );
+      test.execute( ReadAll( "abcdefg" ) );
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -80,6 +80,24 @@ int main()
       test.execute( ReadAll(
         { 0x0d, 0x0a, 0x63, 0x61, 0x0a, 0x66, 0x65, 0x20, 0x62, 0x30, 0x0d, 0x62, 0x00, 0x61, 0x00, 0x00 } ) );
     }
+
+    {
+      ReassemblerTestHarness test { "batch", 16 };
+
+      test.execute( InsertBatch { { { 4, "efgh", false }, { 0, "abc", false }, { 2, "cd", false } } } );
+      test.execute( BytesPushed( 8 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( InsertBatch { { { 12, "mnop", true }, { 20, "x", false }, { 9, "jk", false } } } );
+      test.execute( BytesPushed( 8 ) );
+      test.execute( BytesPending( 6 ) );
+      test.execute( IsFinished( false ) );
+      test.execute( ReadAll( "abcdefgh" ) );
+      test.execute( InsertBatch { { { 8, "i", false }, { 11, "l", false }, { 8, "ijk", false } } } );
+      test.execute( BytesPushed( 16 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "ijklmnop" ) );
+      test.execute( IsFinished( true ) );
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
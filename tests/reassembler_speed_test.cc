@@ -1,107 +1,319 @@
 #include "reassembler.hh"
+#include "speed_test_common.hh"
+#include "trace.hh"
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <queue>
+#include <limits>
 #include <random>
-#include <tuple>
+#include <span>
+#include <string>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
 
-void speed_test( const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t chunk_size,  // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t overlap,     // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
-                 string_view scenario )
+namespace {
+
+double min_gigabits_per_second = 0.1; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+using Arrivals = vector<Reassembler::Segment>;
+
+string random_data( size_t input_len, size_t random_seed )
 {
-  // Generate the data to be written
-  const string data = [&] {
-    default_random_engine rd { random_seed };
-    uniform_int_distribution<char> ud;
-    string ret;
-    for ( size_t i = 0; i < num_chunks * chunk_size; ++i ) {
-      ret += ud( rd );
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  ret.reserve( input_len );
+  for ( size_t i = 0; i < input_len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// Cut the data into consecutive segments, in order.
+Arrivals in_order( const string& data, size_t segment_size )
+{
+  Arrivals ret;
+  for ( size_t i = 0; i < data.size(); i += segment_size ) {
+    ret.push_back( { i, data.substr( i, segment_size ), i + segment_size >= data.size() } );
+  }
+  return ret;
+}
+
+// Shuffle each run of `distance` consecutive segments.
+Arrivals reordered( const string& data, size_t segment_size, size_t distance, size_t random_seed )
+{
+  Arrivals ret = in_order( data, segment_size );
+  default_random_engine rd { random_seed };
+  for ( size_t i = 0; i < ret.size(); i += distance ) {
+    shuffle( ret.begin() + i, ret.begin() + min( i + distance, ret.size() ), rd );
+  }
+  return ret;
+}
+
+// Send every segment `copies` times, with each retransmission also overlapping its successor by half.
+Arrivals duplicated( const string& data, size_t segment_size, size_t copies )
+{
+  Arrivals ret;
+  for ( size_t i = 0; i < data.size(); i += segment_size ) {
+    for ( size_t copy = 0; copy < copies; ++copy ) {
+      const size_t len = copy == 0 ? segment_size : segment_size + segment_size / 2;
+      ret.push_back( { i, data.substr( i, len ), i + len >= data.size() } );
     }
-    return ret;
-  }();
+  }
+  return ret;
+}
 
-  // Split the data into segments before writing
-  queue<tuple<uint64_t, string, bool>> split_data;
+// Within each window-sized block of segments, hold back a random fraction of them until the rest have arrived.
+Arrivals holes_filled_late( const string& data, size_t segment_size, size_t capacity, double loss, size_t seed )
+{
+  const Arrivals segments = in_order( data, segment_size );
+  const size_t block = max<size_t>( capacity / segment_size, 1 );
+  default_random_engine rd { seed };
+  bernoulli_distribution lost { loss };
+
+  Arrivals ret;
+  for ( size_t i = 0; i < segments.size(); i += block ) {
+    Arrivals late;
+    for ( size_t j = i; j < min( i + block, segments.size() ); ++j ) {
+      ( lost( rd ) ? late : ret ).push_back( segments[j] );
+    }
+    ret.insert( ret.end(), late.begin(), late.end() );
+  }
+  return ret;
+}
+
+// Single bytes at every other index of the first `span` bytes (far more runs than the interval budget allows, so
+// most of them force an eviction), then all of the data in order.
+Arrivals forced_evictions( const string& data, size_t span, size_t segment_size )
+{
+  Arrivals ret;
+  for ( size_t i = 1; i < span; i += 2 ) {
+    ret.push_back( { i, data.substr( i, 1 ), false } );
+  }
+  const Arrivals rest = in_order( data, segment_size );
+  ret.insert( ret.end(), rest.begin(), rest.end() );
+  return ret;
+}
+
+// The original pattern: overlapping chunks inserted back to front within each window.
+Arrivals overlapping_reverse( const string& data, size_t chunk_size, size_t overlap, size_t capacity )
+{
+  Arrivals ret;
   for ( size_t i = 0; i < data.size(); i += capacity ) {
     size_t chunk_begin = min( i + capacity - 1, data.size() - 1 );
     while ( true ) {
-      split_data.emplace(
-        chunk_begin, data.substr( chunk_begin, chunk_size ), chunk_begin + chunk_size >= data.size() );
+      ret.push_back(
+        { chunk_begin, data.substr( chunk_begin, chunk_size ), chunk_begin + chunk_size >= data.size() } );
       if ( chunk_begin >= overlap ) {
         chunk_begin -= overlap;
       } else {
-        split_data.emplace( 0, data.substr( 0, chunk_size ), 0 + chunk_size >= data.size() );
+        ret.push_back( { 0, data.substr( 0, chunk_size ), 0 + chunk_size >= data.size() } );
         break;
       }
     }
   }
+  return ret;
+}
 
-  Reassembler reassembler { ByteStream { capacity } };
-
+SpeedTestRecord speed_test( const string& scenario,
+                            const string& data,
+                            Arrivals arrivals,
+                            const size_t capacity, // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t batch_size,
+                            const ByteStream::Storage storage = ByteStream::Storage::Ring )
+{
+  Reassembler reassembler { ByteStream { capacity, storage } };
   string output_data;
   output_data.reserve( data.size() );
+  uint64_t peak_pending = 0;
 
-  const auto start_time = steady_clock::now();
-  while ( not split_data.empty() ) {
-    auto& next = split_data.front();
-    reassembler.insert( get<uint64_t>( next ), move( get<string>( next ) ), get<bool>( next ) );
-    split_data.pop();
+  const SpeedTestTimer timer;
+  for ( size_t i = 0; i < arrivals.size(); i += batch_size ) {
+    if ( batch_size == 1 ) {
+      auto& next = arrivals[i];
+      reassembler.insert( next.first_index, move( next.data ), next.is_last_substring );
+    } else {
+      reassembler.insert_batch( span { arrivals }.subspan( i, min( batch_size, arrivals.size() - i ) ) );
+    }
+    peak_pending = max( peak_pending, reassembler.count_bytes_pending() );
 
     while ( reassembler.reader().bytes_buffered() ) {
-      output_data += reassembler.reader().peek();
-      reassembler.reader().pop( output_data.size() - reassembler.reader().bytes_popped() );
+      const auto peeked = reassembler.reader().peek();
+      output_data += peeked;
+      reassembler.reader().pop( peeked.size() );
     }
   }
+  const double seconds = timer.seconds();
+  const uint64_t allocations = timer.allocations();
 
+  if ( not reassembler.reader().is_finished() ) {
+    throw runtime_error( "Reassembler did not close ByteStream when finished (" + scenario + ")" );
+  }
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (" + scenario + ")" );
+  }
+
+  const double gbps = gigabits_per_second( data.size(), seconds );
+  if ( gbps < min_gigabits_per_second ) {
+    throw runtime_error( "Reassembler (" + scenario + ", capacity=" + to_string( capacity )
+                         + ") did not meet minimum speed of " + to_string( min_gigabits_per_second )
+                         + " Gbit/s" );
+  }
+
+  const auto inserts = static_cast<double>( arrivals.size() );
+  return SpeedTestRecord {}
+    .label( "scenario", scenario )
+    .label( "api", batch_size == 1 ? "insert" : "insert_batch" )
+    .label( "storage", storage == ByteStream::Storage::Chunked ? "chunked" : "ring" )
+    .number( "capacity", static_cast<double>( capacity ) )
+    .number( "data_size", static_cast<double>( data.size() ) )
+    .number( "inserts", inserts )
+    .number( "batch_size", static_cast<double>( batch_size ) )
+    .number( "gbit_per_s", gbps )
+    .number( "inserts_per_s", inserts / seconds )
+    .number( "peak_pending_bytes", static_cast<double>( peak_pending ) )
+    .number( "allocs_per_insert", static_cast<double>( allocations ) / inserts );
+}
+
+// Time `iterations` passes of a loop that adds each index to a volatile checksum (so the compiler must keep every
+// pass), with a trace point in each pass or without. Returns nanoseconds per pass.
+template<bool with_trace_point>
+double checksum_loop_ns( uint64_t iterations )
+{
+  volatile uint64_t checksum = 0;
+  const auto start_time = steady_clock::now();
+  for ( uint64_t i = 0; i < iterations; ++i ) {
+    if constexpr ( with_trace_point ) {
+      trace<TraceLevel::Verbose>( "reassembler", "stored {} bytes", i );
+    }
+    checksum = checksum + i;
+  }
   const auto stop_time = steady_clock::now();
 
-  if ( not reassembler.reader().is_finished() ) {
-    throw runtime_error( "Reassembler did not close ByteStream when finished" );
+  if ( checksum != iterations * ( iterations - 1 ) / 2 ) {
+    throw runtime_error( "trace overhead loop miscounted" );
   }
+  return duration_cast<duration<double, nano>>( stop_time - start_time ).count()
+         / static_cast<double>( iterations );
+}
 
-  if ( data != output_data ) {
-    throw runtime_error( "Mismatch between data written and read" );
+// The speed test is built like minnow_optimized, so every trace point must compile away (which the static_assert
+// guarantees). Time a loop with a trace point in it anyway (with the runtime level turned all the way up) against
+// the same loop without, to show that the point adds nothing.
+SpeedTestRecord trace_overhead_test()
+{
+  static_assert( kMaxTraceLevel == TraceLevel::Off, "trace points should be compiled out of optimized builds" );
+  set_trace_level( TraceLevel::Verbose );
+
+  // Take the fastest of several interleaved runs of each, so that noise (e.g. other load) doesn't count.
+  constexpr uint64_t iterations = 20'000'000;
+  constexpr int runs = 5;
+  double baseline_ns = numeric_limits<double>::infinity();
+  double traced_ns = numeric_limits<double>::infinity();
+  for ( int run = 0; run < runs; ++run ) {
+    baseline_ns = min( baseline_ns, checksum_loop_ns<false>( iterations ) );
+    traced_ns = min( traced_ns, checksum_loop_ns<true>( iterations ) );
+  }
+  set_trace_level( TraceLevel::Off );
+
+  // A trace point left in would call trace_level() on every pass, which costs a nanosecond or more; anything less
+  // is noise (code alignment, other load) between the two loops.
+  const double overhead_ns = traced_ns - baseline_ns;
+  if ( overhead_ns > 1.0 ) {
+    throw runtime_error( "Disabled trace points are not free." );
   }
 
-  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
-  auto bytes_per_second = static_cast<double>( num_chunks * capacity ) / test_duration.count();
-  auto bits_per_second = 8 * bytes_per_second;
-  auto gigabits_per_second = bits_per_second / 1e9;
+  return SpeedTestRecord {}
+    .label( "scenario", "disabled_trace_point" )
+    .number( "calls", static_cast<double>( iterations ) * runs )
+    .number( "baseline_ns_per_pass", baseline_ns )
+    .number( "traced_ns_per_pass", traced_ns )
+    .number( "ns_per_call", overhead_ns );
+}
 
+void program_body( const string& json_path )
+{
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
-       << gigabits_per_second << " Gbit/s.\n";
+  vector<SpeedTestRecord> records;
+
+  // The headline configurations
+  for ( const auto& [overlap, seed, name] :
+        { tuple { 1500, 1370, "(no overlap):  " }, tuple { 150, 6163, "(10x overlap): " } } ) {
+    const string data = random_data( 1000 * 1500, seed );
+    const string scenario = overlap == 1500 ? "reverse" : "reverse_overlap";
+    auto record = speed_test( scenario, data, overlapping_reverse( data, 1500, overlap, 32768 ), 32768, 1 );
+    const double gbps = record.number( "gbit_per_s" );
 
-  debug_output << "        Reassembler throughput " << scenario << fixed << setprecision( 2 ) << setw( 5 )
-               << gigabits_per_second << " Gbit/s\n";
+    cerr << "Reassembler to ByteStream with capacity=32768 reached " << fixed << setprecision( 2 ) << gbps
+         << " Gbit/s.\n";
+    debug_output << "        Reassembler throughput " << name << fixed << setprecision( 2 ) << setw( 5 ) << gbps
+                 << " Gbit/s\n";
 
-  if ( gigabits_per_second < 0.1 ) {
-    throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s." );
+    records.push_back( move( record ) );
   }
-}
 
-void program_body()
-{
-  speed_test( 1000, 1500, 1500, 32768, 1370, "(no overlap):  " );
-  speed_test( 1000, 1500, 150, 32768, 6163, "(10x overlap): " );
+  // Realistic arrival patterns
+  const size_t mss = 1460;
+  const size_t capacity = 65536;
+  const string data = random_data( 1 << 23, 1234 );
+  for ( const size_t batch_size : { 1, 16 } ) {
+    records.push_back( speed_test( "in_order", data, in_order( data, mss ), capacity, batch_size ) );
+    records.push_back( speed_test( "small_reorder", data, reordered( data, mss, 4, 42 ), capacity, batch_size ) );
+  }
+  for ( const auto& [scenario, arrivals] :
+        { pair { "in_order", in_order( data, mss ) }, pair { "small_reorder", reordered( data, mss, 4, 42 ) } } ) {
+    records.push_back( speed_test( scenario, data, arrivals, capacity, 1, ByteStream::Storage::Chunked ) );
+  }
+  records.push_back( speed_test( "heavy_duplication", data, duplicated( data, mss, 3 ), capacity, 1 ) );
+  records.push_back(
+    speed_test( "holes_filled_late", data, holes_filled_late( data, mss, capacity, 0.1, 7 ), capacity, 1 ) );
+  const string small_data = data.substr( 0, 1 << 20 );
+  records.push_back( speed_test( "tiny_fragments", small_data, reordered( small_data, 8, 16, 9 ), capacity, 1 ) );
+
+  // A window far larger than a cache (with few enough holes to stay within the default interval budget)
+  const size_t huge_capacity = 1 << 24;
+  const string huge_data = random_data( 1 << 25, 5678 );
+  records.push_back( speed_test( "huge_capacity_holes",
+                                 huge_data,
+                                 holes_filled_late( huge_data, mss, huge_capacity, 0.05, 11 ),
+                                 huge_capacity,
+                                 1 ) );
+
+  // An adversary fragmenting the start of a huge window: each eviction must cost no more than the run it drops
+  records.push_back( speed_test( "forced_evictions",
+                                 small_data,
+                                 forced_evictions( small_data, 1 << 17, mss ),
+                                 huge_capacity,
+                                 1 ) );
+
+  auto trace_record = trace_overhead_test();
+  debug_output << "        Disabled trace point cost " << fixed << setprecision( 3 )
+               << trace_record.number( "ns_per_call" ) << " ns/call\n";
+  records.push_back( move( trace_record ) );
+
+  write_json( json_path, "reassembler", records );
 }
 
-int main()
+} // namespace
+
+// usage: reassembler_speed_test [JSON_OUTPUT_PATH [MIN_GBIT_PER_S]]
+// The JSON report goes to stdout unless a path is given.
+int main( int argc, char* argv[] )
 {
   try {
-    program_body();
+    const vector<string> args( argv + 1, argv + argc );
+    if ( args.size() > 1 ) {
+      min_gigabits_per_second = stod( args.at( 1 ) );
+    }
+    program_body( args.empty() ? string {} : args.at( 0 ) );
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
@@ -31,6 +31,21 @@ public:
                    { Reassembler { ByteStream { capacity } } } )
   {}
 
+  ReassemblerTestHarness( std::string test_name, uint64_t capacity, uint64_t max_intervals )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ) + ", max_intervals=" + std::to_string( max_intervals ),
+                   { Reassembler { ByteStream { capacity }, max_intervals } } )
+  {}
+
+  ReassemblerTestHarness( std::string test_name, uint64_t capacity, ByteStream::Storage storage )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity )
+                     + ( storage == ByteStream::Storage::Chunked ? ", chunked"
+                         : storage == ByteStream::Storage::Spill ? ", spill"
+                                                                 : ", ring" ),
+                   { Reassembler { ByteStream { capacity, storage } } } )
+  {}
+
   template<std::derived_from<TestStep<ByteStream>> T>
   void execute( const T& test )
   {
@@ -47,6 +62,63 @@ struct BytesPending : public ExpectNumber<Reassembler, uint64_t>
   uint64_t value( const Reassembler& r ) const override { return r.count_bytes_pending(); }
 };
 
+struct IntervalsPending : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "count_pending_intervals"; }
+  uint64_t value( const Reassembler& r ) const override { return r.count_pending_intervals(); }
+};
+
+struct IntervalsEvicted : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "evicted_intervals"; }
+  uint64_t value( const Reassembler& r ) const override { return r.evicted_intervals(); }
+};
+
+struct BytesEvicted : public ExpectNumber<Reassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "evicted_bytes"; }
+  uint64_t value( const Reassembler& r ) const override { return r.evicted_bytes(); }
+};
+
+struct PendingIntervals : public Expectation<Reassembler>
+{
+  size_t max_count_;
+  std::vector<Reassembler::Interval> intervals_;
+
+  PendingIntervals( size_t max_count, std::vector<Reassembler::Interval> intervals )
+    : max_count_( max_count ), intervals_( std::move( intervals ) )
+  {}
+
+  static std::string to_string( const std::vector<Reassembler::Interval>& intervals )
+  {
+    std::ostringstream ss;
+    ss << "{";
+    for ( const auto& [first, end] : intervals ) {
+      ss << " [" << first << ", " << end << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override
+  {
+    return "pending_intervals( " + std::to_string( max_count_ ) + " ) = " + to_string( intervals_ );
+  }
+
+  void execute( const Reassembler& r ) const override
+  {
+    const auto actual = r.pending_intervals( max_count_ );
+    if ( actual != intervals_ ) {
+      throw ExpectationViolation { "should have had pending_intervals( "
+                                   + std::to_string( max_count_ ) + " ) = " + to_string( intervals_ )
+                                   + ", but instead it was " + to_string( actual ) };
+    }
+  }
+};
+
 struct Insert : public Action<Reassembler>
 {
   std::string data_;
@@ -73,3 +145,31 @@ struct Insert : public Action<Reassembler>
 
   void execute( Reassembler& r ) const override { r.insert( first_index_, data_, is_last_substring_ ); }
 };
+
+struct InsertBatch : public Action<Reassembler>
+{
+  std::vector<Reassembler::Segment> segments_;
+
+  explicit InsertBatch( std::vector<Reassembler::Segment> segments ) : segments_( std::move( segments ) ) {}
+
+  std::string description() const override
+  {
+    std::ostringstream ss;
+    ss << "insert_batch {";
+    for ( const auto& [first_index, data, is_last_substring] : segments_ ) {
+      ss << " \"" << pretty_print( data ) << "\" @ index " << first_index;
+      if ( is_last_substring ) {
+        ss << " [last substring]";
+      }
+      ss << ";";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  void execute( Reassembler& r ) const override
+  {
+    auto segments = segments_;
+    r.insert_batch( segments );
+  }
+};
@@ -7,6 +7,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -37,10 +38,10 @@ struct DirectByteStreamTest : public TestStep<TCPReceiver>
 class TCPReceiverTestHarness : public TestHarness<TCPReceiver>
 {
 public:
-  TCPReceiverTestHarness( std::string test_name, uint64_t capacity )
+  TCPReceiverTestHarness( std::string test_name, uint64_t capacity, const TCPConfig& config = {} )
     : TestHarness( move( test_name ),
                    "capacity=" + std::to_string( capacity ),
-                   { TCPReceiver { Reassembler { ByteStream { capacity } } } } )
+                   { TCPReceiver { Reassembler { ByteStream { capacity } }, config } } )
   {}
 
   template<std::derived_from<TestStep<Reassembler>> T>
@@ -108,6 +109,33 @@ struct ExpectAcknoBetween : public Expectation<TCPReceiver>
   }
 };
 
+struct ExpectSack : public Expectation<TCPReceiver>
+{
+  std::vector<TCPReceiverMessage::SackBlock> blocks_;
+
+  explicit ExpectSack( std::vector<TCPReceiverMessage::SackBlock> blocks ) : blocks_( std::move( blocks ) ) {}
+
+  static std::string describe( const std::vector<TCPReceiverMessage::SackBlock>& blocks )
+  {
+    std::string ret = "{";
+    for ( const auto& block : blocks ) {
+      ret += " [" + to_string( block.left ) + ", " + to_string( block.right ) + ")";
+    }
+    return ret + " }";
+  }
+
+  std::string description() const override { return "SACK blocks = " + describe( blocks_ ); }
+
+  void execute( const TCPReceiver& rs ) const override
+  {
+    const auto actual = rs.send().sack;
+    if ( actual != blocks_ ) {
+      throw ExpectationViolation( "SACK blocks should have been " + describe( blocks_ ) + ", but instead were "
+                                  + describe( actual ) );
+    }
+  }
+};
+
 struct HasAckno : public ExpectBool<TCPReceiver>
 {
   using ExpectBool::ExpectBool;
@@ -126,6 +154,18 @@ struct SegmentArrives : public Action<TCPReceiver>
     return *this;
   }
 
+  SegmentArrives& with_window_scale( uint8_t shift )
+  {
+    msg_.window_scale = shift;
+    return *this;
+  }
+
+  SegmentArrives& with_sack_permitted()
+  {
+    msg_.sack_permitted = true;
+    return *this;
+  }
+
   SegmentArrives& with_fin()
   {
     msg_.FIN = true;
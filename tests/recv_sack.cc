@@ -0,0 +1,133 @@
+#include "helpers.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    TCPConfig sack_cfg;
+    sack_cfg.sack = true;
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "SACK blocks report out-of-order data", 4000, sack_cfg };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( ExpectSack { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 11 ).with_data( "klm" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 14 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efg" ) );
+      test.execute( ExpectSack {
+        { { Wrap32 { isn + 5 }, Wrap32 { isn + 8 } }, { Wrap32 { isn + 11 }, Wrap32 { isn + 14 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 8 ).with_data( "hij" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 5 }, Wrap32 { isn + 14 } } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 14 } } );
+      test.execute( ExpectSack { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "At most four SACK blocks, most recent first", 4000, sack_cfg };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      for ( uint32_t i = 5; i > 0; --i ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 + 2 * i ).with_data( "x" ) );
+      }
+      test.execute( ExpectSack { { { Wrap32 { isn + 3 }, Wrap32 { isn + 4 } },
+                                   { Wrap32 { isn + 5 }, Wrap32 { isn + 6 } },
+                                   { Wrap32 { isn + 7 }, Wrap32 { isn + 8 } },
+                                   { Wrap32 { isn + 9 }, Wrap32 { isn + 10 } } } } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "With more than four holes, newer data is still reported", 4000, sack_cfg };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      for ( uint32_t i = 1; i <= 6; ++i ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 + 2 * i ).with_data( "x" ) );
+      }
+      test.execute( ExpectSack { { { Wrap32 { isn + 13 }, Wrap32 { isn + 14 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 12 } },
+                                   { Wrap32 { isn + 9 }, Wrap32 { isn + 10 } },
+                                   { Wrap32 { isn + 7 }, Wrap32 { isn + 8 } } } } );
+
+      // Filling the gap between the two lowest runs reports the merged run first.
+      test.execute( SegmentArrives {}.with_seqno( isn + 4 ).with_data( "y" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 3 }, Wrap32 { isn + 6 } },
+                                   { Wrap32 { isn + 13 }, Wrap32 { isn + 14 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 12 } },
+                                   { Wrap32 { isn + 9 }, Wrap32 { isn + 10 } } } } );
+
+      // A retransmission of older data moves its run to the front.
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "x" ) );
+      test.execute( ExpectSack { { { Wrap32 { isn + 9 }, Wrap32 { isn + 10 } },
+                                   { Wrap32 { isn + 3 }, Wrap32 { isn + 6 } },
+                                   { Wrap32 { isn + 13 }, Wrap32 { isn + 14 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 12 } } } } );
+
+      // Once the reported runs are delivered, the rest fill the blocks, lowest first.
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "ab" ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 6 } } );
+      test.execute( ExpectSack { { { Wrap32 { isn + 9 }, Wrap32 { isn + 10 } },
+                                   { Wrap32 { isn + 13 }, Wrap32 { isn + 14 } },
+                                   { Wrap32 { isn + 11 }, Wrap32 { isn + 12 } },
+                                   { Wrap32 { isn + 7 }, Wrap32 { isn + 8 } } } } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No SACK blocks unless the sender permits them", 4000, sack_cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efg" ) );
+      test.execute( ExpectSack { {} } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No SACK blocks unless enabled", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efg" ) );
+      test.execute( ExpectSack { {} } );
+    }
+
+    {
+      // The options survive a trip through the wire format.
+      TCPSenderMessage sender_message { .seqno = Wrap32 { 1000 }, .SYN = true, .sack_permitted = true };
+      TCPReceiverMessage receiver_message { .ackno = Wrap32 { 2000 }, .window_size = 1234 };
+      for ( uint32_t i = 0; i < 5; ++i ) {
+        receiver_message.sack.push_back( { Wrap32 { 2010 + 10 * i }, Wrap32 { 2015 + 10 * i } } );
+      }
+
+      TCPSegment seg { .message = { borrow( sender_message ), borrow( receiver_message ) } };
+      seg.compute_checksum( 0 );
+      if ( seg.header_length() != TCPSegment::HEADER_LENGTH + 4 + 36 ) {
+        throw runtime_error( "TCPSegment: SACK-permitted and four SACK blocks should fill the options" );
+      }
+
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( seg ), 0 ) ) {
+        throw runtime_error( "TCPSegment: could not parse a segment with options" );
+      }
+      receiver_message.sack.resize( TCPReceiverMessage::MAX_SACK_BLOCKS );
+      if ( not parsed.message.sender->sack_permitted or parsed.message.receiver->sack != receiver_message.sack
+           or parsed.message.receiver->window_size != 1234 or not parsed.message.sender->SYN ) {
+        throw runtime_error( "TCPSegment: options did not round-trip: " + parsed.to_string() );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#include "byte_stream_test_harness.hh"
+#include "helpers.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    TCPConfig cfg;
+    cfg.recv_capacity = 1'000'000;
+    cfg.window_scaling = true;
+    if ( cfg.window_scale() != 4 ) {
+      throw runtime_error( "TCPConfig: a 1 MB window should need a shift of 4" );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "Window scaled once both sides offer it", cfg.recv_capacity, cfg };
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { 62'500 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 100, 'x' ) ) );
+      test.execute( ExpectWindow { ( 1'000'000 - 100 ) >> 4 } );
+      test.execute( ReadAll { string( 100, 'x' ) } );
+      test.execute( ExpectWindow { 62'500 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "Window not scaled unless the sender offers it", cfg.recv_capacity, cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "Window not scaled unless enabled", cfg.recv_capacity };
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      // The option survives a trip through the wire format, alongside SACK-permitted, but only on a SYN.
+      TCPSenderMessage sender_message {
+        .seqno = Wrap32 { 1000 }, .SYN = true, .sack_permitted = true, .window_scale = 9 };
+      TCPReceiverMessage receiver_message { .ackno = Wrap32 { 2000 }, .window_size = 1234 };
+
+      TCPSegment seg { .message = { borrow( sender_message ), borrow( receiver_message ) } };
+      seg.compute_checksum( 0 );
+      if ( seg.header_length() != TCPSegment::HEADER_LENGTH + 8 ) {
+        throw runtime_error( "TCPSegment: wrong header length with window scale and SACK-permitted" );
+      }
+      TCPSegment parsed;
+      if ( not parse( parsed, serialize( seg ), 0 ) ) {
+        throw runtime_error( "TCPSegment: could not parse a segment with options" );
+      }
+      if ( parsed.message.sender->window_scale != 9 or not parsed.message.sender->sack_permitted ) {
+        throw runtime_error( "TCPSegment: options did not round-trip: " + parsed.to_string() );
+      }
+
+      sender_message.SYN = false;
+      TCPSegment data_seg { .message = { borrow( sender_message ), borrow( receiver_message ) } };
+      if ( data_seg.header_length() != TCPSegment::HEADER_LENGTH ) {
+        throw runtime_error( "TCPSegment: SYN options should only be sent on a SYN" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
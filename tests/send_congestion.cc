@@ -0,0 +1,176 @@
+#include "congestion_control.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+void check( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+void newreno_windows()
+{
+  NewReno cc { MSS };
+  check( cc.cwnd() == 10 * MSS, "newreno: initial window should be ten segments" );
+
+  // Slow start counts at most two segments per ack.
+  cc.on_ack( { .bytes_acked = 5 * MSS } );
+  check( cc.cwnd() == 12 * MSS, "newreno: slow start should grow by at most 2*MSS per ack" );
+
+  cc.on_loss( 0, 12 * MSS );
+  check( cc.cwnd() == 6 * MSS and cc.ssthresh() == 6 * MSS, "newreno: loss should halve the window" );
+
+  // Congestion avoidance: one segment per window acknowledged.
+  for ( int i = 0; i < 6; ++i ) {
+    cc.on_ack( { .bytes_acked = MSS } );
+  }
+  check( cc.cwnd() == 7 * MSS, "newreno: congestion avoidance should add one segment per window" );
+
+  cc.on_rto( 0, 7 * MSS );
+  check( cc.cwnd() == MSS and cc.ssthresh() == 3 * MSS + MSS / 2, "newreno: timeout should collapse the window" );
+}
+
+void cubic_windows()
+{
+  Cubic cc { MSS };
+
+  // Slow start to a thousand segments, then lose one.
+  while ( cc.cwnd() < 1000 * MSS ) {
+    cc.on_ack( { .bytes_acked = 2 * MSS } );
+  }
+  cc.on_loss( 0, cc.cwnd() );
+  check( cc.cwnd() == 700 * MSS, "cubic: loss should reduce the window by 30%" );
+
+  // Ack a full window every 100 ms; the window climbs back to its old peak (concave), then beyond (convex).
+  const double k_seconds = cbrt( 300 / Cubic::C );
+  uint64_t now_ms = 0;
+  const auto run_until = [&]( double seconds ) {
+    while ( now_ms < static_cast<uint64_t>( seconds * 1000 ) ) {
+      now_ms += 100;
+      cc.on_ack( { .now_ms = now_ms, .bytes_acked = cc.cwnd(), .rtt_ms = 100 } );
+    }
+  };
+
+  run_until( k_seconds / 2 );
+  check( cc.cwnd() > 900 * MSS and cc.cwnd() < 1000 * MSS, "cubic: should approach the old peak quickly" );
+  run_until( k_seconds );
+  check( cc.cwnd() > 980 * MSS and cc.cwnd() < 1020 * MSS, "cubic: should plateau near the old peak" );
+  run_until( 2 * k_seconds );
+  check( cc.cwnd() > 1200 * MSS, "cubic: should probe beyond the old peak" );
+
+  cc.on_rto( now_ms, cc.cwnd() );
+  check( cc.cwnd() == MSS, "cubic: timeout should collapse the window" );
+}
+
+void bbr_model()
+{
+  // A path that delivers one segment per millisecond with a 10 ms round trip: its BDP is ten segments.
+  constexpr uint64_t rtt_ms = 10;
+  constexpr uint64_t bdp = 10 * MSS;
+  BBR cc { MSS };
+  check( cc.pacing_rate() == 0, "bbr: should not pace before measuring anything" );
+
+  uint64_t delivered = 0;
+  for ( uint64_t now_ms = 1; now_ms <= 300; ++now_ms ) {
+    delivered += MSS;
+    cc.on_ack( { .now_ms = now_ms,
+                 .bytes_acked = MSS,
+                 .bytes_in_flight = bdp,
+                 .delivered = delivered,
+                 .rtt_ms = rtt_ms,
+                 .prior_delivered = delivered > bdp ? delivered - bdp : 0 } );
+  }
+
+  check( cc.bottleneck_bandwidth() == MSS * 1000, "bbr: wrong bandwidth estimate" );
+  check( cc.min_rtt_ms() == rtt_ms, "bbr: wrong min RTT" );
+  check( cc.mode() == BBR::Mode::ProbeBW, "bbr: should have left startup once bandwidth stopped growing" );
+  check( cc.cwnd() == 2 * bdp, "bbr: window should be twice the BDP" );
+  check( cc.pacing_rate() >= MSS * 750 and cc.pacing_rate() <= MSS * 1250, "bbr: should pace near the bandwidth" );
+
+  cc.on_loss( 301, bdp );
+  check( cc.cwnd() == 2 * bdp, "bbr: a loss alone should not change the window" );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    newreno_windows();
+    cubic_windows();
+    bbr_model();
+
+    for ( const auto algorithm : { CongestionControl::Algorithm::NewReno, CongestionControl::Algorithm::Cubic } ) {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = algorithm;
+      const string name { CongestionControl::make( algorithm, MSS )->name() };
+
+      TCPSenderTestHarness test { name + ": initial window limits the first flight", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ) );
+      test.execute( ExpectCongestionWindow { 10 * MSS + 1 } );
+      test.execute( Push { string( 20 * MSS, 'x' ) } );
+      for ( int i = 0; i < 10; ++i ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( MSS ) );
+      }
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 10 * MSS + 1 } );
+
+      // A timeout leaves room for just the retransmission.
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_no_flags().with_payload_size( MSS ).with_seqno( isn + 1 ) );
+      test.execute( ExpectCongestionWindow { MSS } );
+      test.execute( AckReceived { isn + 1 + MSS }.with_win( UINT16_MAX ) );
+      test.execute( ExpectNoSegment {} );
+
+      // Once everything is acknowledged the window is back in slow start, well short of the receiver's.
+      test.execute( AckReceived { isn + 1 + 10 * MSS + 1 }.with_win( UINT16_MAX ) );
+      test.execute( ExpectCongestionWindow { 4 * MSS } );
+      for ( int i = 0; i < 4; ++i ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( MSS ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "none: only the receiver's window applies", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 30 * MSS ) );
+      test.execute( Push { string( 40 * MSS, 'x' ) } );
+      for ( int i = 0; i < 30; ++i ) {
+        test.execute( ExpectMessage {}.with_no_flags().with_payload_size( MSS ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
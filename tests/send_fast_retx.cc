@@ -0,0 +1,158 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Connect, then send "a" through "e" as five one-byte segments and have "a" acknowledged.
+void send_five( TCPSenderTestHarness& test, Wrap32 isn )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+  test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+  for ( const auto* data : { "a", "b", "c", "d", "e" } ) {
+    test.execute( Push { data } );
+    test.execute( ExpectMessage {}.with_data( data ) );
+  }
+  test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+  test.execute( ExpectNoSegment {} );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.dupack_threshold = TCPConfig::DUPACK_THRESHOLD;
+
+      TCPSenderTestHarness test { "Three duplicate acks trigger a fast retransmit", cfg };
+      send_five( test, isn );
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions { 1 } );
+      test.execute( ExpectConsecutiveRetransmissions { 0 } );
+      test.execute( ExpectSeqnosInFlight { 4 } );
+      test.execute( AckReceived { isn + 6 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.dupack_threshold = TCPConfig::DUPACK_THRESHOLD;
+
+      TCPSenderTestHarness test { "A partial ack resends the next hole at once", cfg };
+      send_five( test, isn );
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+      }
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+      test.execute( AckReceived { isn + 4 }.with_win( 1000 ) );
+      test.execute( ExpectMessage {}.with_data( "d" ).with_seqno( isn + 4 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 6 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions { 2 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.dupack_threshold = TCPConfig::DUPACK_THRESHOLD;
+
+      TCPSenderTestHarness test { "Window updates are not duplicate acks", cfg };
+      send_five( test, isn );
+      test.execute( AckReceived { isn + 2 }.with_win( 999 ) );
+      test.execute( AckReceived { isn + 2 }.with_win( 998 ) );
+      test.execute( AckReceived { isn + 2 }.with_win( 997 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 2 }.with_win( 997 ) );
+      test.execute( AckReceived { isn + 2 }.with_win( 997 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 2 }.with_win( 997 ) );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without a threshold, duplicate acks are ignored", cfg };
+      send_five( test, isn );
+      for ( int i = 0; i < 5; ++i ) {
+        test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions { 0 } );
+    }
+
+    {
+      constexpr uint64_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.dupack_threshold = TCPConfig::DUPACK_THRESHOLD;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "Fast recovery halves the window and inflates it per duplicate", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ) );
+      test.execute( Push { string( 10 * mss, 'x' ) } );
+      for ( int i = 0; i < 10; ++i ) {
+        test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      }
+      test.execute( AckReceived { isn + 1 + mss }.with_win( UINT16_MAX ) );
+
+      // Nine segments are in flight when the second is found lost: ssthresh = 4500, plus three duplicates.
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( AckReceived { isn + 1 + mss }.with_win( UINT16_MAX ) );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( mss ).with_seqno( isn + 1 + mss ) );
+      test.execute( ExpectCongestionWindow { 9 * mss / 2 } );
+
+      // 7500 < 9000 in flight: new data waits until two more duplicates have arrived.
+      test.execute( Push { string( 5 * mss, 'y' ) } );
+      test.execute( AckReceived { isn + 1 + mss }.with_win( UINT16_MAX ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1 + mss }.with_win( UINT16_MAX ) );
+      test.execute( ExpectMessage {}.with_payload_size( mss / 2 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // Once everything is acknowledged, the window deflates to ssthresh.
+      test.execute( AckReceived { isn + 1 + 10 * mss + mss / 2 }.with_win( UINT16_MAX ) );
+      test.execute( ExpectCongestionWindow { 9 * mss / 2 } );
+      for ( int i = 0; i < 4; ++i ) {
+        test.execute( ExpectMessage {}.with_payload_size( mss ) );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( mss / 2 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without an MTU, payloads are MAX_PAYLOAD_SIZE, whatever the peer's MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerMSS { 500 } );
+      test.execute( ExpectMSS { TCPConfig::MAX_PAYLOAD_SIZE } );
+      test.execute( AckReceived { isn + 1 }.with_win( 5000 ) );
+      test.execute( Push { string( 1500, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( TCPConfig::MAX_PAYLOAD_SIZE ) );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mtu = 9000;
+
+      TCPSenderTestHarness test { "Jumbo frames: the SYN advertises the MSS, and payloads fill it", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 8960 ) );
+      test.execute( PeerMSS { 8960 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 20000 ) );
+      test.execute( Push { string( 20000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 2080 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mtu = 9000;
+
+      TCPSenderTestHarness test { "The smaller of the two sides' MSS applies", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 8960 ) );
+      test.execute( PeerMSS { 1460 } );
+      test.execute( ExpectMSS { 1460 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 5000 ) );
+      test.execute( Push { string( 3000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 80 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mtu = 1500;
+
+      TCPSenderTestHarness test { "A peer that doesn't say gets the default MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( 1460 ) );
+      test.execute( PeerMSS { TCPConfig::DEFAULT_PEER_MSS } );
+      test.execute( AckReceived { isn + 1 }.with_win( 5000 ) );
+      test.execute( Push { string( 600, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( TCPConfig::DEFAULT_PEER_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( 600 - TCPConfig::DEFAULT_PEER_MSS ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mtu = 9000;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "The congestion window counts negotiated segments", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerMSS { 8960 } );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ) );
+      test.execute( ExpectCongestionWindow { 10 * 8960 + 1 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.mtu = 1500;
+
+      TCPSenderTestHarness test { "New payloads leave room for the SACK blocks the segment will carry", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerMSS { 1460 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 5000 ) );
+      test.execute( OptionSpace { 20 } ); // two SACK blocks
+      test.execute( Push { string( 3000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1440 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1440 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 120 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
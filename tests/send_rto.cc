@@ -0,0 +1,131 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Fixed RTO still measures round trips", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 40 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSmoothedRTT { 40 } );
+      test.execute( ExpectRTO { cfg.rt_timeout } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.rto_min_ms = 10;
+
+      TCPSenderTestHarness test { "Adaptive RTO follows round trips, but not of retransmissions", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 40 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSmoothedRTT { 40 } );
+      test.execute( ExpectRTO { 120 } ); // 40 + 4 * 20
+
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 119 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( ExpectRTO { 240 } );
+
+      // The ack of a retransmitted segment is ambiguous, so the RTO stays backed off.
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { isn + 4 } );
+      test.execute( ExpectSmoothedRTT { 40 } );
+      test.execute( ExpectRTO { 240 } );
+
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 30 } );
+      test.execute( AckReceived { isn + 7 } );
+      test.execute( ExpectSmoothedRTT { 38.75 } );
+      test.execute( ExpectRTO { 109 } ); // 38.75 + 4 * 17.5, rounded up
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.rto_max_ms = 1000;
+
+      TCPSenderTestHarness test { "Adaptive RTO stays within its floor and ceiling", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectRTO { TCPConfig::RTO_MIN_DFLT } );
+
+      test.execute( Push { "x" } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      test.execute( Tick { TCPConfig::RTO_MIN_DFLT - 1 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      for ( const uint64_t rto : { 400, 800, 1000, 1000 } ) {
+        test.execute( ExpectRTO { rto } );
+        test.execute( Tick { rto - 1 } );
+        test.execute( ExpectNoSegment {} );
+        test.execute( Tick { 1 } );
+        test.execute( ExpectMessage {}.with_data( "x" ) );
+      }
+      test.execute( ExpectRTO { 1000 } );
+      test.execute( ExpectConsecutiveRetransmissions { 5 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.rto_min_ms = 10;
+
+      TCPSenderTestHarness test { "An ack that covers a retransmission isn't timed, even for later segments", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Tick { 40 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectRTTSamples { 1 } );
+
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 120 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+
+      // "def" waited at the receiver for the hole to be filled, so this ack says nothing about its trip.
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { isn + 7 } );
+      test.execute( ExpectRTTSamples { 1 } );
+      test.execute( ExpectSmoothedRTT { 40 } );
+      test.execute( ExpectRTO { 240 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Connect, then send one-byte segments "a", "b", ... and have "a" acknowledged.
+void send_letters( TCPSenderTestHarness& test, Wrap32 isn, int count )
+{
+  test.execute( Push {} );
+  test.execute(
+    ExpectMessage {}.with_no_flags().with_syn( true ).with_sack_permitted( true ).with_seqno( isn ) );
+  test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+  for ( char c = 'a'; c < 'a' + count; ++c ) {
+    test.execute( Push { string( 1, c ) } );
+    test.execute( ExpectMessage {}.with_data( string( 1, c ) ) );
+  }
+  test.execute( AckReceived { isn + 2 }.with_win( 1000 ) );
+  test.execute( ExpectNoSegment {} );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "SACK is only offered when enabled, and otherwise ignored", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( false ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ).with_sack( isn + 2, isn + 4 ) );
+      test.execute( ExpectSackedBytes { 0 } );
+    }
+
+    for ( const bool peer_permits : { false, true } ) {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+
+      TCPSenderTestHarness test { "A SYN-ACK only permits SACK if the peer's SYN did", cfg };
+      test.execute( PeerSackPermitted { peer_permits } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( peer_permits ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+      cfg.dupack_threshold = TCPConfig::DUPACK_THRESHOLD;
+
+      TCPSenderTestHarness test { "Fast retransmit resends every hole, and nothing SACKed", cfg };
+      send_letters( test, isn, 7 );
+
+      // "b" and "d" are lost; the rest arrive.
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 4 ) );
+      test.execute(
+        AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 4 ).with_sack( isn + 5, isn + 6 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 4 ).with_sack( isn + 5, isn + 7 ) );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+      test.execute( ExpectMessage {}.with_data( "d" ).with_seqno( isn + 4 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 4 ).with_sack( isn + 5, isn + 8 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSackedBytes { 4 } );
+      test.execute( ExpectSeqnosInFlight { 6 } );
+      test.execute( ExpectFastRetransmissions { 2 } );
+
+      // The repaired holes arrive in turn; neither is sent again.
+      test.execute( AckReceived { isn + 4 }.with_win( 1000 ).with_sack( isn + 5, isn + 8 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSackedBytes { 3 } );
+      test.execute( AckReceived { isn + 8 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSackedBytes { 0 } );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+
+      TCPSenderTestHarness test { "After a timeout, the holes are resent as acks return", cfg };
+      send_letters( test, isn, 5 );
+
+      // "b" and "d" are lost.
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 4 ) );
+      test.execute(
+        AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 4 ).with_sack( isn + 5, isn + 6 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( AckReceived { isn + 4 }.with_win( 1000 ).with_sack( isn + 5, isn + 6 ) );
+      test.execute( ExpectMessage {}.with_data( "d" ).with_seqno( isn + 4 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 6 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+
+      TCPSenderTestHarness test { "A timeout forgets what was SACKed, in case the receiver reneged", cfg };
+      send_letters( test, isn, 5 );
+
+      // "b" is lost; the receiver SACKs the rest, but then discards it.
+      test.execute( AckReceived { isn + 2 }.with_win( 1000 ).with_sack( isn + 3, isn + 6 ) );
+      test.execute( ExpectSackedBytes { 3 } );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+      test.execute( ExpectSackedBytes { 0 } );
+      test.execute( ExpectNoSegment {} );
+
+      // Nothing is SACKed any more, so each ack shows the next segment missing.
+      for ( char c = 'c'; c <= 'e'; ++c ) {
+        test.execute( AckReceived { isn + 1 + ( c - 'a' ) }.with_win( 1000 ) );
+        test.execute( ExpectMessage {}.with_data( string( 1, c ) ).with_seqno( isn + 1 + ( c - 'a' ) ) );
+        test.execute( ExpectNoSegment {} );
+      }
+      test.execute( AckReceived { isn + 6 }.with_win( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.sack = true;
+      cfg.congestion_control = CongestionControl::Algorithm::NewReno;
+
+      TCPSenderTestHarness test { "SACKed data doesn't count against the congestion window", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ) );
+      test.execute( Push { string( 12 * TCPConfig::MAX_PAYLOAD_SIZE, 'x' ) } );
+      for ( int i = 0; i < 10; ++i ) {
+        test.execute( ExpectMessage {}.with_payload_size( TCPConfig::MAX_PAYLOAD_SIZE ) );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( 1 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // The first segment is lost, but the receiver holds the second: there's room for one more.
+      const auto mss = static_cast<uint32_t>( TCPConfig::MAX_PAYLOAD_SIZE );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ).with_sack( isn + 1 + mss, isn + 1 + 2 * mss ) );
+      test.execute( ExpectMessage {}.with_payload_size( TCPConfig::MAX_PAYLOAD_SIZE ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.window_scaling = true;
+      cfg.recv_capacity = 1 << 20;
+
+      TCPSenderTestHarness test { "Peer's windows are scaled once both sides offer it", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( 5 ) );
+      test.execute( PeerWindowScale { 4 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 100 ) );
+      test.execute( Push { string( 3 * MSS, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( 600 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 1600 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.window_scaling = true;
+      cfg.send_capacity = 1 << 20;
+
+      TCPSenderTestHarness test { "More than 64 KB in flight", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerWindowScale { TCPConfig::MAX_WINDOW_SCALE + 2 } ); // too big: treated as the maximum
+      test.execute( AckReceived { isn + 1 }.with_win( 8 ) );
+      test.execute( Push { string( 200 * MSS, 'x' ) } );
+      for ( int i = 0; i < 131; ++i ) {
+        test.execute( ExpectMessage {}.with_payload_size( MSS ) );
+      }
+      test.execute( ExpectMessage {}.with_payload_size( 72 ) ); // 8 << 14 = 131,072
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 8 << 14 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "No scaling unless this side offered it", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerWindowScale { 4 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 100 ) );
+      test.execute( Push { string( 3 * MSS, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 100 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.window_scaling = true;
+
+      TCPSenderTestHarness test { "A SYN-ACK only offers window scaling if the peer's SYN did", cfg };
+      test.execute( PeerSackPermitted { false } ); // the peer's SYN has arrived, offering no options
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).without_window_scale() );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.window_scaling = true;
+      cfg.recv_capacity = 1 << 20;
+
+      TCPSenderTestHarness test { "A SYN-ACK offers window scaling in reply to a SYN that did", cfg };
+      test.execute( PeerSackPermitted { false } );
+      test.execute( PeerWindowScale { 3 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( 5 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -55,7 +55,7 @@ public:
   TCPSenderTestHarness( std::string name, TCPConfig config )
     : TestHarness( move( name ),
                    "initial_RTO_ms=" + to_string( config.rt_timeout ) + " and ISN=" + to_string( config.isn ),
-                   { TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
+                   { TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout, config } } )
   {}
 
   template<std::derived_from<TestStep<TCPSender>> T>
@@ -104,6 +104,55 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<TCPSender, uint64_
   uint64_t value( const TCPSender& sender ) const override { return sender.consecutive_retransmissions(); }
 };
 
+struct ExpectRTO : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "current_RTO_ms"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.current_RTO_ms(); }
+};
+
+struct ExpectSmoothedRTT : public ExpectNumber<TCPSender, double>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_stats().smoothed_ms"; }
+  double value( const TCPSender& sender ) const override { return sender.rtt_stats().smoothed_ms; }
+};
+
+struct ExpectRTTSamples : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_stats().samples"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.rtt_stats().samples; }
+};
+
+struct ExpectFastRetransmissions : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "fast_retransmissions"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.fast_retransmissions(); }
+};
+
+struct ExpectMSS : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "mss"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.mss(); }
+};
+
+struct ExpectSackedBytes : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "sacked_bytes"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.sacked_bytes(); }
+};
+
+struct ExpectCongestionWindow : public ExpectNumber<TCPSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_control().cwnd()"; }
+  uint64_t value( const TCPSender& sender ) const override { return sender.congestion_control().cwnd(); }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -222,7 +271,11 @@ struct Receive : public Action<SenderAndOutput>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const auto& block : msg_.sack ) {
+      desc << ", sack=[" << to_string( block.left ) << ", " << to_string( block.right ) << ")";
+    }
+    desc << ")";
     if ( push_ ) {
       desc << ", then push";
     }
@@ -243,6 +296,12 @@ struct Receive : public Action<SenderAndOutput>
     }
   }
 
+  Receive& with_sack( Wrap32 left, Wrap32 right )
+  {
+    msg_.sack.push_back( { left, right } );
+    return *this;
+  }
+
   Receive& without_push()
   {
     push_ = false;
@@ -252,6 +311,55 @@ struct Receive : public Action<SenderAndOutput>
   constexpr std::string obj() const override { return "TCPSender"; }
 };
 
+struct PeerWindowScale : public Action<SenderAndOutput>
+{
+  uint8_t shift_;
+
+  explicit PeerWindowScale( uint8_t shift ) : shift_( shift ) {}
+  std::string description() const override
+  {
+    return "peer's SYN offers window scale " + std::to_string( shift_ );
+  }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_peer_window_scale( shift_ ); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
+struct PeerSackPermitted : public Action<SenderAndOutput>
+{
+  bool permitted_;
+
+  explicit PeerSackPermitted( bool permitted ) : permitted_( permitted ) {}
+  std::string description() const override
+  {
+    return std::string( "peer's SYN " ) + ( permitted_ ? "permits" : "doesn't permit" ) + " SACK";
+  }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_peer_sack_permitted( permitted_ ); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
+struct PeerMSS : public Action<SenderAndOutput>
+{
+  uint64_t mss_;
+
+  explicit PeerMSS( uint64_t mss ) : mss_( mss ) {}
+  std::string description() const override { return "peer's SYN advertises MSS " + std::to_string( mss_ ); }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_peer_mss( mss_ ); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
+struct OptionSpace : public Action<SenderAndOutput>
+{
+  uint64_t bytes_;
+
+  explicit OptionSpace( uint64_t bytes ) : bytes_( bytes ) {}
+  std::string description() const override
+  {
+    return "segments will carry " + std::to_string( bytes_ ) + " bytes of other options";
+  }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_option_space( bytes_ ); }
+  constexpr std::string obj() const override { return "TCPSender"; }
+};
+
 struct AckReceived : public Receive
 {
   explicit AckReceived( Wrap32 ackno ) : Receive( { ackno, DEFAULT_TEST_WINDOW } ) {}
@@ -283,8 +391,16 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
+  std::optional<bool> sack_permitted {};
+  std::optional<uint8_t> window_scale {};
+  bool no_window_scale {};
+  std::optional<uint16_t> mss {};
 
-  bool empty() const { return not( syn or fin or rst or seqno or data or payload_size ); }
+  bool empty() const
+  {
+    return not( syn or fin or rst or seqno or data or payload_size or sack_permitted or window_scale
+                or no_window_scale or mss );
+  }
 
   ExpectMessage& with_syn( bool syn_ )
   {
@@ -330,6 +446,30 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     return *this;
   }
 
+  ExpectMessage& with_sack_permitted( bool sack_permitted_ )
+  {
+    sack_permitted = sack_permitted_;
+    return *this;
+  }
+
+  ExpectMessage& with_window_scale( uint8_t window_scale_ )
+  {
+    window_scale = window_scale_;
+    return *this;
+  }
+
+  ExpectMessage& without_window_scale()
+  {
+    no_window_scale = true;
+    return *this;
+  }
+
+  ExpectMessage& with_mss( uint16_t mss_ )
+  {
+    mss = mss_;
+    return *this;
+  }
+
   std::string message_description() const
   {
     std::ostringstream o;
@@ -361,6 +501,18 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( rst.has_value() ) {
       o << ( rst.value() ? " +RST" : " -RST" );
     }
+    if ( sack_permitted.has_value() ) {
+      o << ( sack_permitted.value() ? " +SACK_PERMITTED" : " -SACK_PERMITTED" );
+    }
+    if ( window_scale.has_value() ) {
+      o << " wscale=" << static_cast<unsigned>( window_scale.value() );
+    }
+    if ( no_window_scale ) {
+      o << " -wscale";
+    }
+    if ( mss.has_value() ) {
+      o << " mss=" << mss.value();
+    }
     return o.str();
   }
 
@@ -377,10 +529,13 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 
     const TCPSenderMessage seg = ss.expect_message();
 
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.sender.mss() ) {
       throw ExpectationViolation( "sent a message with a " + std::to_string( seg.payload.size() )
                                   + "-byte payload, which is longer than the maximum ("
-                                  + std::to_string( TCPConfig::MAX_PAYLOAD_SIZE ) + ")" );
+                                  + std::to_string( ss.sender.mss() ) + ")" );
+    }
+    if ( mss.has_value() and seg.mss != mss ) {
+      throw MessageExpectationViolation( seg, "MSS option", mss, seg.mss );
     }
     if ( syn.has_value() and seg.SYN != syn.value() ) {
       throw MessageExpectationViolation( seg, "SYN flag", syn.value(), seg.SYN );
@@ -400,6 +555,15 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( data.has_value() and data.value() != static_cast<std::string>( seg.payload ) ) {
       throw MessageExpectationViolation( seg, "payload", data.value(), static_cast<std::string>( seg.payload ) );
     }
+    if ( sack_permitted.has_value() and seg.sack_permitted != sack_permitted.value() ) {
+      throw MessageExpectationViolation( seg, "SACK-permitted option", sack_permitted.value(), seg.sack_permitted );
+    }
+    if ( window_scale.has_value() and seg.window_scale != window_scale ) {
+      throw MessageExpectationViolation( seg, "window scale option", window_scale, seg.window_scale );
+    }
+    if ( no_window_scale and seg.window_scale.has_value() ) {
+      throw MessageExpectationViolation( seg, "window scale option", std::optional<uint8_t> {}, seg.window_scale );
+    }
   }
 
   constexpr std::string obj() const override { return "TCPSender"; }
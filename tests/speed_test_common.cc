@@ -0,0 +1,132 @@
+#include "speed_test_common.hh"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+using namespace std;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+namespace {
+atomic<uint64_t> allocations_made { 0 };
+} // namespace
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+// Count every heap allocation made by the benchmark (replaces the global operator new).
+void* operator new( size_t size )
+{
+  allocations_made.fetch_add( 1, memory_order_relaxed );
+  if ( void* ptr = malloc( size == 0 ? 1 : size ) ) { // NOLINT(*-no-malloc)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* ptr, size_t /*size*/ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+uint64_t allocation_count()
+{
+  return allocations_made.load( memory_order_relaxed );
+}
+
+SpeedTestRecord& SpeedTestRecord::label( string name, string value )
+{
+  labels.emplace_back( move( name ), move( value ) );
+  return *this;
+}
+
+SpeedTestRecord& SpeedTestRecord::number( string name, double value )
+{
+  numbers.emplace_back( move( name ), value );
+  return *this;
+}
+
+const string& SpeedTestRecord::label( string_view name ) const
+{
+  for ( const auto& [key, value] : labels ) {
+    if ( key == name ) {
+      return value;
+    }
+  }
+  throw runtime_error( "no label named " + string( name ) + " in speed test record" );
+}
+
+double SpeedTestRecord::number( string_view name ) const
+{
+  for ( const auto& [key, value] : numbers ) {
+    if ( key == name ) {
+      return value;
+    }
+  }
+  throw runtime_error( "no number named " + string( name ) + " in speed test record" );
+}
+
+double SpeedTestTimer::seconds() const
+{
+  return chrono::duration_cast<chrono::duration<double>>( chrono::steady_clock::now() - start_time_ ).count();
+}
+
+namespace {
+string quoted( string_view str )
+{
+  string ret = "\"";
+  for ( const char ch : str ) {
+    if ( ch == '"' or ch == '\\' ) {
+      ret += '\\';
+    }
+    ret += ch;
+  }
+  return ret + "\"";
+}
+} // namespace
+
+void write_json( ostream& out, string_view benchmark, const vector<SpeedTestRecord>& records )
+{
+  out << "{\n  \"benchmark\": " << quoted( benchmark ) << ",\n  \"results\": [";
+  for ( size_t i = 0; i < records.size(); ++i ) {
+    out << ( i ? ",\n" : "\n" ) << "    {";
+    bool first = true;
+    for ( const auto& [name, value] : records[i].labels ) {
+      out << ( first ? " " : ", " ) << quoted( name ) << ": " << quoted( value );
+      first = false;
+    }
+    for ( const auto& [name, value] : records[i].numbers ) {
+      out << ( first ? " " : ", " ) << quoted( name ) << ": ";
+      if ( isfinite( value ) ) {
+        out << setprecision( 10 ) << value;
+      } else {
+        out << "null";
+      }
+      first = false;
+    }
+    out << " }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+void write_json( const string& path, string_view benchmark, const vector<SpeedTestRecord>& records )
+{
+  if ( path.empty() ) {
+    write_json( cout, benchmark, records );
+    return;
+  }
+
+  ofstream file { path };
+  if ( not file ) {
+    throw runtime_error( "could not open " + path );
+  }
+  write_json( file, benchmark, records );
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Number of calls to the global operator new made so far by this process.
+uint64_t allocation_count();
+
+// One row of a benchmark report: descriptive labels plus measured numbers, in insertion order.
+struct SpeedTestRecord
+{
+  std::vector<std::pair<std::string, std::string>> labels {};
+  std::vector<std::pair<std::string, double>> numbers {};
+
+  SpeedTestRecord& label( std::string name, std::string value );
+  SpeedTestRecord& number( std::string name, double value );
+
+  const std::string& label( std::string_view name ) const; // look up a label by name
+  double number( std::string_view name ) const;            // look up a measured number by name
+};
+
+// Measures wall-clock time and heap allocations over a region of a benchmark.
+class SpeedTestTimer
+{
+  std::chrono::steady_clock::time_point start_time_ { std::chrono::steady_clock::now() };
+  uint64_t start_allocations_ { allocation_count() };
+
+public:
+  double seconds() const;
+  uint64_t allocations() const { return allocation_count() - start_allocations_; }
+};
+
+inline double gigabits_per_second( uint64_t bytes, double seconds )
+{
+  return 8.0 * static_cast<double>( bytes ) / seconds / 1e9;
+}
+
+// Writes a machine-readable report: { "benchmark": name, "results": [ { labels..., numbers... }, ... ] }
+void write_json( std::ostream& out, std::string_view benchmark, const std::vector<SpeedTestRecord>& records );
+
+// Writes the report to `path`, or to stdout if `path` is empty.
+void write_json( const std::string& path, std::string_view benchmark, const std::vector<SpeedTestRecord>& records );
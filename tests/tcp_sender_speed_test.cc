@@ -0,0 +1,143 @@
+#include "speed_test_common.hh"
+#include "tcp_sender.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Push `write_size`-byte writes one at a time, so each becomes its own segment, until `outstanding` segments are
+// in flight; then acknowledge them all and repeat. Every push() has to account for everything in flight.
+SpeedTestRecord speed_test( const size_t write_size, // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t outstanding,
+                            const size_t rounds )
+{
+  const Wrap32 isn { 1234 };
+  TCPSender sender { ByteStream { 1 << 20 }, isn, 1000 };
+  uint64_t segments_sent = 0;
+  const auto count = [&]( const TCPSenderMessage& /*unused*/ ) { ++segments_sent; };
+
+  sender.receive( { {}, UINT16_MAX, false } );
+  sender.push( count ); // SYN
+  sender.receive( { isn + 1, UINT16_MAX, false } );
+
+  const string data( write_size, 'x' );
+  uint64_t pushes = 0;
+  uint64_t acked = 1;
+
+  const SpeedTestTimer timer;
+  for ( size_t round = 0; round < rounds; ++round ) {
+    for ( size_t i = 0; i < outstanding; ++i ) {
+      sender.writer().push( data );
+      sender.push( count );
+      ++pushes;
+    }
+    if ( sender.sequence_numbers_in_flight() != outstanding * write_size ) {
+      throw runtime_error( "TCPSender has the wrong number of sequence numbers in flight" );
+    }
+    acked += outstanding * write_size;
+    sender.receive( { Wrap32::wrap( acked, isn ), UINT16_MAX, false } );
+  }
+  const double seconds = timer.seconds();
+
+  if ( segments_sent != 1 + rounds * outstanding ) {
+    throw runtime_error( "TCPSender sent the wrong number of segments" );
+  }
+
+  return SpeedTestRecord {}
+    .label( "scenario", "small_writes" )
+    .number( "write_size", static_cast<double>( write_size ) )
+    .number( "outstanding_segments", static_cast<double>( outstanding ) )
+    .number( "pushes", static_cast<double>( pushes ) )
+    .number( "ns_per_push", seconds * 1e9 / static_cast<double>( pushes ) );
+}
+
+// Send `total` bytes through a sender on an interface with the given MTU (0 for MAX_PAYLOAD_SIZE-byte payloads),
+// a window at a time, acknowledging each window as a whole. Bigger segments mean fewer of them per byte.
+SpeedTestRecord bulk_test( const size_t mtu, const size_t total )
+{
+  const Wrap32 isn { 1234 };
+  TCPConfig config;
+  config.mtu = mtu;
+  TCPSender sender { ByteStream { 1 << 20 }, isn, 1000, config };
+  sender.set_peer_mss( config.mss() );
+  uint64_t segments_sent = 0;
+  const auto count = [&]( const TCPSenderMessage& /*unused*/ ) { ++segments_sent; };
+
+  sender.receive( { {}, UINT16_MAX, false } );
+  sender.push( count ); // SYN
+  sender.receive( { isn + 1, UINT16_MAX, false } );
+
+  const string data( UINT16_MAX, 'x' );
+  uint64_t acked = 1;
+
+  const SpeedTestTimer timer;
+  while ( acked < 1 + total ) {
+    sender.writer().push( data );
+    sender.push( count );
+    acked += sender.sequence_numbers_in_flight();
+    sender.receive( { Wrap32::wrap( acked, isn ), UINT16_MAX, false } );
+  }
+  const double seconds = timer.seconds();
+
+  return SpeedTestRecord {}
+    .label( "scenario", "bulk" )
+    .number( "mtu", static_cast<double>( mtu ) )
+    .number( "mss", static_cast<double>( sender.mss() ) )
+    .number( "segments", static_cast<double>( segments_sent ) )
+    .number( "ns_per_byte", seconds * 1e9 / static_cast<double>( acked - 1 ) );
+}
+
+uint64_t sender_mss( const SpeedTestRecord& record )
+{
+  return static_cast<uint64_t>( record.number( "mss" ) );
+}
+
+void program_body( const string& json_path )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  vector<SpeedTestRecord> records;
+  for ( const size_t outstanding : { 64, 1024, 4096 } ) {
+    const size_t write_size = min( TCPConfig::MAX_PAYLOAD_SIZE, UINT16_MAX / outstanding );
+    auto record = speed_test( write_size, outstanding, ( 1 << 16 ) / outstanding );
+    debug_output << "        TCPSender push with " << setw( 4 ) << outstanding << " segments outstanding: " << fixed
+                 << setprecision( 1 ) << setw( 7 ) << record.number( "ns_per_push" ) << " ns/push\n";
+    records.push_back( move( record ) );
+  }
+
+  for ( const size_t mtu : { 0, 1500, 9000 } ) {
+    auto record = bulk_test( mtu, 1 << 26 );
+    debug_output << "        TCPSender bulk transfer with " << setw( 4 ) << sender_mss( record )
+                 << "-byte segments: " << fixed << setprecision( 3 ) << setw( 7 ) << record.number( "ns_per_byte" )
+                 << " ns/byte\n";
+    records.push_back( move( record ) );
+  }
+
+  write_json( json_path, "tcp_sender", records );
+}
+
+} // namespace
+
+// usage: tcp_sender_speed_test [JSON_OUTPUT_PATH]
+// The JSON report goes to stdout unless a path is given.
+int main( int argc, char* argv[] )
+{
+  try {
+    const vector<string> args( argv + 1, argv + argc );
+    program_body( args.empty() ? string {} : args.at( 0 ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -27,6 +27,29 @@ int main()
       test_should_be( Wrap32( n ) != Wrap32( m ), n != m );
     }
 
+    // Serial-number ordering and distance, across the wrap
+    test_should_be( Wrap32( UINT32_MAX ) < Wrap32( 2 ), true );
+    test_should_be( Wrap32( 2 ) > Wrap32( UINT32_MAX ), true );
+    test_should_be( Wrap32( 2 ) - Wrap32( UINT32_MAX ), 3U );
+    test_should_be( Wrap32( UINT32_MAX ).distance( Wrap32( 2 ) ), -3 );
+    test_should_be( Wrap32( 5 ) - 7 == Wrap32( UINT32_MAX - 1 ), true );
+    test_should_be( Wrap32( 5 ) <= Wrap32( 5 ), true );
+    test_should_be( Wrap32( 5 ) < Wrap32( 5 ), false );
+
+    for ( size_t i = 0; i < N_REPS; i++ ) {
+      const uint32_t n = rd();
+      const uint32_t diff = rd() % ( 1U << 31 );
+      const Wrap32 a { n };
+      const Wrap32 b = a + diff;
+      test_should_be( b - a, diff );
+      test_should_be( a.distance( b ), -static_cast<int32_t>( diff ) );
+      test_should_be( a <= b, true );
+      test_should_be( b >= a, true );
+      test_should_be( a < b, diff != 0 );
+      test_should_be( b > a, diff != 0 );
+      test_should_be( b < a, false );
+    }
+
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
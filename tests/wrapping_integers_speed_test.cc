@@ -0,0 +1,140 @@
+#include "speed_test_common.hh"
+#include "wrapping_integers.hh"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// The three-candidate unwrap that Wrap32 used before, kept as a baseline.
+uint64_t reference_unwrap( uint32_t raw_value, uint32_t zero_point, uint64_t checkpoint )
+{
+  const uint32_t offset = raw_value - zero_point;
+  uint64_t result = offset;
+  if ( checkpoint > ( 1ULL << 31 ) ) {
+    const uint64_t base = ( checkpoint - offset ) & ~0xFFFFFFFFULL;
+    const uint64_t candidate1 = base + offset;
+    const uint64_t candidate2 = candidate1 + ( 1ULL << 32 );
+    const uint64_t candidate0 = candidate1 < ( 1ULL << 32 ) ? 0 : candidate1 - ( 1ULL << 32 );
+    const uint64_t diff0 = candidate0 > checkpoint ? candidate0 - checkpoint : checkpoint - candidate0;
+    const uint64_t diff1 = candidate1 > checkpoint ? candidate1 - checkpoint : checkpoint - candidate1;
+    const uint64_t diff2 = candidate2 > checkpoint ? candidate2 - checkpoint : checkpoint - candidate2;
+    if ( diff0 <= diff1 and diff0 <= diff2 ) {
+      result = candidate0;
+    } else if ( diff2 <= diff1 and diff2 <= diff0 ) {
+      result = candidate2;
+    } else {
+      result = candidate1;
+    }
+  }
+  return result;
+}
+
+// Raw sequence numbers scattered within a window either side of the checkpoint, as in a burst of segments or
+// ACKs.
+vector<uint32_t> burst( size_t count, uint32_t zero_point, uint64_t checkpoint, uint64_t window, size_t seed )
+{
+  default_random_engine rd { seed };
+  uniform_int_distribution<uint64_t> offset { 0, 2 * window };
+  vector<uint32_t> ret;
+  ret.reserve( count );
+  for ( size_t i = 0; i < count; ++i ) {
+    ret.push_back( static_cast<uint32_t>( checkpoint - window + offset( rd ) ) + zero_point );
+  }
+  return ret;
+}
+
+template<typename Unwrap>
+SpeedTestRecord speed_test( const string& method, const vector<Wrap32>& seqnos, size_t rounds, Unwrap&& unwrap )
+{
+  vector<uint64_t> out( seqnos.size() );
+  uint64_t checksum = 0;
+
+  const SpeedTestTimer timer;
+  for ( size_t round = 0; round < rounds; ++round ) {
+    unwrap( out );
+    checksum += out[round % out.size()];
+  }
+  const double seconds = timer.seconds();
+
+  const auto operations = static_cast<double>( rounds * seqnos.size() );
+  return SpeedTestRecord {}
+    .label( "method", method )
+    .number( "burst_size", static_cast<double>( seqnos.size() ) )
+    .number( "ns_per_op", seconds * 1e9 / operations )
+    .number( "checksum", static_cast<double>( checksum % 1000 ) );
+}
+
+void program_body( const string& json_path )
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  const uint32_t raw_zero_point = 0xdeadbeef;
+  const Wrap32 zero_point { raw_zero_point };
+  const uint64_t checkpoint = ( uint64_t { 5 } << 32 ) + 12345;
+  vector<SpeedTestRecord> records;
+
+  for ( const size_t burst_size : { 64, 4096 } ) {
+    const vector<uint32_t> raw_seqnos = burst( burst_size, raw_zero_point, checkpoint, 1 << 20, burst_size );
+    const vector<Wrap32> seqnos { raw_seqnos.begin(), raw_seqnos.end() };
+    const size_t rounds = ( 1 << 26 ) / burst_size;
+
+    // All three methods must agree before any of them is timed.
+    vector<uint64_t> batch( seqnos.size() );
+    Wrap32::unwrap_batch( seqnos, zero_point, checkpoint, batch );
+    for ( size_t i = 0; i < seqnos.size(); ++i ) {
+      if ( seqnos[i].unwrap( zero_point, checkpoint ) != batch[i]
+           or reference_unwrap( raw_seqnos[i], raw_zero_point, checkpoint ) != batch[i] ) {
+        throw runtime_error( "unwrap methods disagree" );
+      }
+    }
+
+    records.push_back( speed_test( "reference", seqnos, rounds, [&]( vector<uint64_t>& out ) {
+      for ( size_t i = 0; i < raw_seqnos.size(); ++i ) {
+        out[i] = reference_unwrap( raw_seqnos[i], raw_zero_point, checkpoint );
+      }
+    } ) );
+    records.push_back( speed_test( "unwrap", seqnos, rounds, [&]( vector<uint64_t>& out ) {
+      for ( size_t i = 0; i < seqnos.size(); ++i ) {
+        out[i] = seqnos[i].unwrap( zero_point, checkpoint );
+      }
+    } ) );
+    records.push_back( speed_test( "unwrap_batch", seqnos, rounds, [&]( vector<uint64_t>& out ) {
+      Wrap32::unwrap_batch( seqnos, zero_point, checkpoint, out );
+    } ) );
+
+    for ( const auto& record : span { records }.last( 3 ) ) {
+      debug_output << "        Wrap32 " << setw( 12 ) << record.labels.front().second << " (burst " << setw( 4 )
+                   << burst_size << "): " << fixed << setprecision( 2 ) << record.number( "ns_per_op" )
+                   << " ns/op\n";
+    }
+  }
+
+  write_json( json_path, "wrapping_integers", records );
+}
+
+} // namespace
+
+// usage: wrapping_integers_speed_test [JSON_OUTPUT_PATH]
+// The JSON report goes to stdout unless a path is given.
+int main( int argc, char* argv[] )
+{
+  try {
+    const vector<string> args( argv + 1, argv + argc );
+    program_body( args.empty() ? string {} : args.at( 0 ) );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
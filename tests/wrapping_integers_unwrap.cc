@@ -1,6 +1,7 @@
 #include "test_should_be.hh"
 #include "wrapping_integers.hh"
 
+#include <array>
 #include <cstdint>
 #include <exception>
 #include <iostream>
@@ -37,6 +38,20 @@ int main()
     // Big unwrap with non-zero ISN and low non-zero checkpoint
     // test credit: Thanawan Atchariyachanvanit
     test_should_be( Wrap32( 0 ).unwrap( Wrap32( 1 ), 1 ), static_cast<uint64_t>( UINT32_MAX ) );
+
+    // Unwrapping is constexpr
+    static_assert( Wrap32( 1 ).unwrap( Wrap32( 0 ), UINT32_MAX ) == ( 1UL << 32 ) + 1 );
+    static_assert( Wrap32( 15 ).unwrap( Wrap32( 16 ), 0 ) == UINT32_MAX );
+
+    // Batch unwrap matches unwrapping one at a time
+    const array seqnos { Wrap32( 1 ), Wrap32( UINT32_MAX - 10 ), Wrap32( 7 ), Wrap32( 1U << 31 ) };
+    for ( const uint64_t checkpoint : { 0UL, 3 * ( 1UL << 32 ), ( 1UL << 31 ) + 5 } ) {
+      array<uint64_t, seqnos.size()> out {};
+      Wrap32::unwrap_batch( seqnos, Wrap32( 3 ), checkpoint, out );
+      for ( size_t i = 0; i < seqnos.size(); ++i ) {
+        test_should_be( out.at( i ), seqnos.at( i ).unwrap( Wrap32( 3 ), checkpoint ) );
+      }
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return 1;
@@ -0,0 +1,84 @@
+#include "chunk_pool.hh"
+
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct ThreadPool
+{
+  array<vector<string>, ChunkPool::kSizeClasses.size()> free_lists {};
+  ChunkPool::Stats stats {};
+
+  ThreadPool()
+  {
+    // Reserve up front so that release() never has to allocate (and so can never throw).
+    for ( size_t i = 0; i < free_lists.size(); ++i ) {
+      free_lists.at( i ).reserve( ChunkPool::kMaxCached.at( i ) );
+    }
+  }
+};
+
+ThreadPool& this_thread_pool()
+{
+  thread_local ThreadPool pool;
+  return pool;
+}
+
+} // namespace
+
+string ChunkPool::acquire( size_t min_capacity )
+{
+  ThreadPool& pool = this_thread_pool();
+
+  for ( size_t i = 0; i < kSizeClasses.size(); ++i ) {
+    if ( kSizeClasses.at( i ) < min_capacity ) {
+      continue;
+    }
+    // Any cached buffer of this class or a larger one is big enough.
+    for ( size_t j = i; j < kSizeClasses.size(); ++j ) {
+      auto& free_list = pool.free_lists.at( j );
+      if ( not free_list.empty() ) {
+        string ret = move( free_list.back() );
+        free_list.pop_back();
+        ++pool.stats.hits;
+        return ret;
+      }
+    }
+    min_capacity = kSizeClasses.at( i ); // allocate the whole class so the buffer can be reused later
+    break;
+  }
+
+  ++pool.stats.misses;
+  string ret;
+  ret.reserve( min_capacity );
+  return ret;
+}
+
+void ChunkPool::release( string&& buffer ) noexcept
+{
+  const size_t capacity = buffer.capacity();
+  if ( capacity < kSizeClasses.front() or capacity > 2 * kSizeClasses.back() ) {
+    return; // not worth keeping: the string's destructor frees it
+  }
+
+  // File the buffer under the largest class it can serve.
+  size_t size_class = 0;
+  while ( size_class + 1 < kSizeClasses.size() and kSizeClasses.at( size_class + 1 ) <= capacity ) {
+    ++size_class;
+  }
+
+  ThreadPool& pool = this_thread_pool();
+  auto& free_list = pool.free_lists.at( size_class );
+  if ( free_list.size() < kMaxCached.at( size_class ) ) {
+    buffer.clear();
+    free_list.push_back( move( buffer ) );
+    ++pool.stats.released;
+  }
+}
+
+ChunkPool::Stats ChunkPool::stats()
+{
+  return this_thread_pool().stats;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * ChunkPool: a per-thread cache of string buffers in a few fixed size classes (2 KiB, 16 KiB, 64 KiB).
+ *
+ * Short-lived byte buffers (datagrams read from a file descriptor, payloads queued in a ByteStream or
+ * consumed by the Reassembler) are acquired from the pool and released back to it when their bytes
+ * have been consumed, so that steady-state traffic reuses the same allocations instead of calling malloc
+ * and free for every segment. Each thread has its own pool, so no locking is needed; a buffer released
+ * by a different thread than the one that acquired it simply joins the releasing thread's pool.
+ */
+class ChunkPool
+{
+public:
+  static constexpr std::array<size_t, 3> kSizeClasses { 2048, 16384, 65536 };
+  static constexpr std::array<size_t, 3> kMaxCached { 256, 64, 16 }; // per size class, per thread
+
+  // Returns an empty string with capacity for at least `min_capacity` bytes, reusing a cached buffer
+  // if one is available.
+  static std::string acquire( size_t min_capacity );
+
+  // Gives a buffer back to the calling thread's pool. Buffers that are too small or too large for any
+  // size class, or that would overflow the cache, are freed.
+  static void release( std::string&& buffer ) noexcept;
+
+  struct Stats
+  {
+    uint64_t hits;     // acquires satisfied from the cache
+    uint64_t misses;   // acquires that had to allocate
+    uint64_t released; // buffers accepted back into the cache
+  };
+
+  // Counters for the calling thread's pool
+  static Stats stats();
+};
+
+// A buffer on loan from the calling thread's ChunkPool, returned to the pool when the handle is destroyed
+// (unless its contents have been taken with release()).
+class PooledChunk
+{
+  std::string buffer_;
+
+public:
+  explicit PooledChunk( size_t min_capacity ) : buffer_( ChunkPool::acquire( min_capacity ) ) {}
+  ~PooledChunk() { ChunkPool::release( std::move( buffer_ ) ); }
+
+  PooledChunk( PooledChunk&& other ) noexcept = default;
+  PooledChunk& operator=( PooledChunk&& other ) noexcept = default;
+  PooledChunk( const PooledChunk& other ) = delete;
+  PooledChunk& operator=( const PooledChunk& other ) = delete;
+
+  std::string& operator*() { return buffer_; }
+  const std::string& operator*() const { return buffer_; }
+  std::string* operator->() { return &buffer_; }
+  const std::string* operator->() const { return &buffer_; }
+
+  // Take ownership of the buffer; it will no longer be returned to the pool automatically.
+  std::string release() { return std::move( buffer_ ); }
+};
@@ -1,5 +1,6 @@
 #include "file_descriptor.hh"
 
+#include "chunk_pool.hh"
 #include "exception.hh"
 
 #include <fcntl.h>
@@ -81,14 +82,26 @@ FileDescriptor FileDescriptor::duplicate() const
 void FileDescriptor::read( string& buffer )
 {
   if ( buffer.empty() ) {
+    if ( buffer.capacity() < kReadBufferSize ) {
+      buffer = ChunkPool::acquire( kReadBufferSize );
+    }
     buffer.resize( kReadBufferSize );
   }
 
+  buffer.resize( read( span<char> { buffer } ) );
+}
+
+// buffer is the memory to be read into
+size_t FileDescriptor::read( span<char> buffer )
+{
+  if ( buffer.empty() ) {
+    return 0;
+  }
+
   const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
   if ( bytes_read < 0 ) {
     if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
-      buffer.clear();
-      return;
+      return 0;
     }
     throw unix_error { "read" };
   }
@@ -103,7 +116,7 @@ void FileDescriptor::read( string& buffer )
     throw runtime_error( "read() read more than requested" );
   }
 
-  buffer.resize( bytes_read );
+  return bytes_read;
 }
 
 void FileDescriptor::read( vector<string>& buffers )
@@ -113,6 +126,9 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 
   buffers.back().clear();
+  if ( buffers.back().capacity() < kReadBufferSize ) {
+    buffers.back() = ChunkPool::acquire( kReadBufferSize );
+  }
   buffers.back().resize( kReadBufferSize );
 
   vector<iovec> iovecs;
@@ -1,10 +1,19 @@
 #include "parser.hh"
+#include "chunk_pool.hh"
 
 #include <cassert>
 #include <string>
 
 using namespace std;
 
+// Return an owned buffer whose bytes have been consumed to the ChunkPool
+void Parser::BufferList::recycle( Ref<std::string>& buffer )
+{
+  if ( buffer.is_owned() ) {
+    ChunkPool::release( buffer.release() );
+  }
+}
+
 string_view Parser::BufferList::peek() const
 {
   if ( buffer_.empty() ) {
@@ -21,6 +30,7 @@ void Parser::BufferList::remove_prefix( uint64_t len )
     len -= to_pop_now;
     size_ -= to_pop_now;
     if ( skip_ == buffer_.front()->size() ) {
+      recycle( buffer_.front() );
       buffer_.pop_front();
       skip_ = 0;
     }
@@ -34,6 +44,9 @@ void Parser::BufferList::truncate( size_t len )
   }
 
   if ( len == 0 ) {
+    for ( auto& x : buffer_ ) {
+      recycle( x );
+    }
     buffer_.clear();
     size_ = 0;
     return;
@@ -61,6 +74,7 @@ void Parser::BufferList::truncate( size_t len )
   }
 
   while ( it != buffer_.end() ) {
+    recycle( *it );
     it = buffer_.erase( it );
   }
 
@@ -75,6 +89,7 @@ void Parser::BufferList::dump_all( vector<Ref<std::string>>& out )
   }
   if ( skip_ ) {
     out.emplace_back( buffer_.front()->substr( skip_ ) );
+    recycle( buffer_.front() );
   } else {
     out.push_back( move( buffer_.front() ) );
   }
@@ -126,6 +141,7 @@ void Parser::concatenate_all_remaining( std::string& out )
   if ( concat.size() > 1 ) {
     for ( auto it = concat.begin() + 1; it != concat.end(); ++it ) {
       out.append( *it );
+      BufferList::recycle( *it );
     }
   }
 }
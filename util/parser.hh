@@ -43,6 +43,8 @@ class Parser
     void truncate( size_t len );
     void dump_all( std::vector<Ref<std::string>>& out );
     std::vector<std::string_view> buffer() const;
+
+    static void recycle( Ref<std::string>& buffer );
   };
 
   BufferList input_;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "address.hh"
+#include "congestion_control.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 
@@ -10,15 +12,68 @@
 class TCPConfig
 {
 public:
-  static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
-  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
-  static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
-  static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t DEFAULT_CAPACITY = 64000;             //!< Default capacity
+  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;              //!< Conservative max payload size for real Internet
+  static constexpr uint16_t TIMEOUT_DFLT = 1000;                //!< Default re-transmit timeout is 1 second
+  static constexpr unsigned MAX_RETX_ATTEMPTS = 8;              //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t SPILL_THRESHOLD = size_t { 1 } << 28; //!< Default spill threshold (256 MiB)
+  static constexpr size_t MAX_REASSEMBLY_INTERVALS = 1024;      //!< Default out-of-order fragment budget
+  static constexpr uint64_t RTO_MIN_DFLT = 200;                 //!< Default adaptive re-transmit timeout floor
+  static constexpr uint64_t RTO_MAX_DFLT = 60000;               //!< Default adaptive re-transmit timeout ceiling
+  static constexpr unsigned DUPACK_THRESHOLD = 3;               //!< Duplicate acks that signal a loss (RFC 5681)
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14;               //!< Largest window scale shift (RFC 7323)
+  static constexpr size_t HEADERS_LENGTH = 40;                  //!< IPv4 and TCP headers, without options
+  static constexpr size_t DEFAULT_PEER_MSS = 536;               //!< Peer's MSS if its SYN doesn't say (RFC 9293)
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+
+  //! Send or receive capacities above this are buffered in a mapped temporary file rather than in memory
+  size_t spill_threshold = SPILL_THRESHOLD;
+  //! How many disjoint out-of-order runs of bytes the receiver keeps before evicting the farthest
+  size_t max_reassembly_intervals = MAX_REASSEMBLY_INTERVALS;
+  //! How the sender limits its own window below the receiver's (by default, it doesn't)
+  CongestionControl::Algorithm congestion_control = CongestionControl::Algorithm::None;
+  //! Adapt the retransmission timeout to measured round-trip times (RFC 6298), within [rto_min_ms, rto_max_ms],
+  //! rather than keeping it at rt_timeout (doubled on each timeout)
+  bool adaptive_rto = false;
+  uint64_t rto_min_ms = RTO_MIN_DFLT; //!< Floor for the adaptive retransmission timeout, in milliseconds
+  uint64_t rto_max_ms = RTO_MAX_DFLT; //!< Ceiling for the adaptive retransmission timeout, in milliseconds
+  //! How many duplicate acks trigger a fast retransmit and recovery (e.g. DUPACK_THRESHOLD), or 0 to leave loss
+  //! recovery to the retransmission timer alone
+  unsigned dupack_threshold = 0;
+  //! Offer selective acknowledgments (RFC 2018) on the SYN; if the peer offers them too, each side's receiver
+  //! reports the out-of-order data it holds, and each side's sender retransmits only what is missing
+  bool sack = false;
+  //! Offer window scaling (RFC 7323) on the SYN; if the peer offers it too, each side advertises its window in
+  //! units of 2^(its shift) bytes, so windows (and the data in flight) can exceed 65,535 bytes
+  bool window_scaling = false;
+
+  //! MTU of the interface the connection runs over, or 0 to send MAX_PAYLOAD_SIZE-byte payloads. If set, each
+  //! SYN advertises the largest payload its side can receive (its MSS, mss()), and the sender sends payloads of
+  //! up to the smaller of its own MSS and the peer's
+  size_t mtu = 0;
+
+  //! The largest payload this side sends (until it hears the peer's MSS), and that it can receive
+  size_t mss() const
+  {
+    if ( mtu == 0 ) {
+      return MAX_PAYLOAD_SIZE;
+    }
+    return std::clamp<size_t>( mtu, HEADERS_LENGTH + 1, UINT16_MAX ) - HEADERS_LENGTH;
+  }
+
+  //! The shift this side offers: the smallest that lets its receiver advertise all of recv_capacity
+  uint8_t window_scale() const
+  {
+    uint8_t shift = 0;
+    while ( shift < MAX_WINDOW_SCALE and ( recv_capacity >> shift ) > UINT16_MAX ) {
+      ++shift;
+    }
+    return shift;
+  }
 };
 
 //! Config for classes derived from FdAdapter
@@ -100,10 +100,9 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _thread_data,
     Direction::In,
     [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      // read directly into the outbound stream's free space
+      Writer& outbound = _tcp->outbound_writer();
+      outbound.commit( _thread_data.read( outbound.reserve( outbound.available_capacity() ) ) );
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -138,14 +137,10 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     Direction::Out,
     [&] {
       Reader& inbound = _tcp->inbound_reader();
-      // Write from the inbound_stream into
-      // the pipe, handling the possibility of a partial
-      // write (i.e., only pop what was actually written).
-      if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
-        inbound.pop( bytes_written );
-      }
+      // Write everything buffered in the inbound_stream into
+      // the pipe with one writev, handling the possibility of a partial
+      // write (drain_to only pops what was actually written).
+      inbound.drain_to( _thread_data );
 
       if ( inbound.is_finished() or inbound.has_error() ) {
         _thread_data.shutdown( SHUT_WR );
@@ -7,6 +7,8 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <optional>
 
@@ -27,10 +29,15 @@ public:
   using TransmitFunction = std::function<void( TCPMessage )>;
 
   /* Passthrough methods */
-  void push( const TransmitFunction& transmit ) { sender_.push( make_send( transmit ) ); }
+  void push( const TransmitFunction& transmit )
+  {
+    reserve_option_space();
+    sender_.push( make_send( transmit ) );
+  }
   void tick( uint64_t t, const TransmitFunction& transmit )
   {
     cumulative_time_ += t;
+    reserve_option_space();
     sender_.tick( t, make_send( transmit ) );
   }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
@@ -62,13 +69,25 @@ public:
     // If SenderMessage is a "keep-alive" (with intentionally invalid seqno), make sure to reply.
     // (N.B. orthodox TCP rules require a reply on any unacceptable segment.)
     const auto our_ackno = receiver_.send().ackno;
-    need_send_ |= ( our_ackno.has_value() and msg.sender->seqno + 1 == our_ackno.value() );
+    need_send_ |= ( our_ackno.has_value() and our_ackno.value() - msg.sender->seqno == 1 );
+
+    // The peer's SYN says how large a segment it can receive, and may offer window scaling (which doesn't
+    // apply to the window in the SYN itself).
+    const bool peer_offers_window_scale = msg.sender->SYN and msg.sender->window_scale.has_value();
+    const uint8_t peer_window_scale = msg.sender->window_scale.value_or( 0 );
+    if ( msg.sender->SYN ) {
+      sender_.set_peer_mss( msg.sender->mss.value_or( TCPConfig::DEFAULT_PEER_MSS ) );
+      sender_.set_peer_sack_permitted( msg.sender->sack_permitted );
+    }
 
-    // Give incoming TCPSenderMessage to receiver.
-    receiver_.receive( std::move( msg.sender ) );
+    // Give incoming TCPSenderMessage to receiver (moving the payload if we own it, rather than copying it).
+    receiver_.receive( msg.sender.release() );
 
     // Give incoming TCPReceiverMessage to sender.
     sender_.receive( msg.receiver );
+    if ( peer_offers_window_scale ) {
+      sender_.set_peer_window_scale( peer_window_scale );
+    }
 
     // Send reply if needed.
     push( transmit );
@@ -88,14 +107,52 @@ public:
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
-  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
+  TCPSender sender_ { ByteStream { cfg_.send_capacity,
+                                   cfg_.send_capacity > cfg_.spill_threshold ? ByteStream::Storage::Spill
+                                                                              : ByteStream::Storage::Ring },
+                      cfg_.isn,
+                      cfg_.rt_timeout,
+                      cfg_ };
+  TCPReceiver receiver_ {
+    Reassembler { ByteStream { cfg_.recv_capacity,
+                               cfg_.recv_capacity > cfg_.spill_threshold ? ByteStream::Storage::Spill
+                                                                          : ByteStream::Storage::Chunked },
+                  cfg_.max_reassembly_intervals },
+    cfg_ };
 
   bool need_send_ {};
 
+  // Options count against the MSS too (RFC 6691). Leave room in new data segments for the SACK blocks that our
+  // acks carry now, so a full-sized segment doesn't crowd them out.
+  void reserve_option_space()
+  {
+    if ( cfg_.mtu > 0 ) {
+      const TCPSenderMessage no_data {};
+      const TCPReceiverMessage receiver_message = receiver_.send();
+      sender_.set_option_space(
+        TCPSegment { .message = { borrow( no_data ), borrow( receiver_message ) } }.header_length()
+        - TCPSegment::HEADER_LENGTH );
+    }
+  }
+
   void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
   {
-    transmit( { borrow( sender_message ), receiver_.send() } );
+    TCPReceiverMessage receiver_message = receiver_.send();
+    // The window in a SYN is never scaled (RFC 7323 section 2.2).
+    if ( sender_message.SYN ) {
+      receiver_message.window_size
+        = static_cast<uint16_t>( std::min<uint64_t>( receiver_.writer().available_capacity(), UINT16_MAX ) );
+    }
+    // A segment sent before the SACK blocks grew (a retransmission, or a SYN with options of its own) may still
+    // not have room for them all; SACK blocks are only advice, so drop any that don't fit (the least recently
+    // reported go first).
+    while ( cfg_.mtu > 0 and not receiver_message.sack.empty()
+            and TCPSegment { .message = { borrow( sender_message ), borrow( receiver_message ) } }.header_length()
+                    - TCPSegment::HEADER_LENGTH + sender_message.payload.size()
+                  > sender_.mss() ) {
+      receiver_message.sack.pop_back();
+    }
+    transmit( { borrow( sender_message ), std::move( receiver_message ) } );
     need_send_ = false;
   }
 
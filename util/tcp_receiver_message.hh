@@ -2,21 +2,28 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstddef>
 #include <optional>
+#include <vector>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
  *
- * It contains three fields:
+ * It contains four fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by the TCP Receiver.
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
  *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    the <cstdint> header), unless both sides negotiated window scaling, in which case it counts in units
+ *    of 2^(the receiver's window scale) sequence numbers.
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 4) Selective acknowledgments (SACK, RFC 2018): runs of sequence numbers beyond the ackno that the receiver
+ *    already holds, most recently reported first (the first is the run that the latest segment landed in). Only
+ *    sent to a sender that offered SACK-permitted on its SYN.
  */
 
 struct TCPReceiverMessage
@@ -24,4 +31,14 @@ struct TCPReceiverMessage
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
   bool RST {};
+
+  // The sequence numbers [left, right) have been received.
+  struct SackBlock
+  {
+    Wrap32 left { 0 };
+    Wrap32 right { 0 };
+    bool operator==( const SackBlock& other ) const = default;
+  };
+  static constexpr size_t MAX_SACK_BLOCKS = 4; // as many as fit in the TCP header's 40 bytes of options
+  std::vector<SackBlock> sack {};
 };
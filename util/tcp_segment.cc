@@ -3,12 +3,132 @@
 #include "helpers.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <span>
 #include <sstream>
 
 using namespace std;
 
 static_assert( !( TCPSegment::HEADER_LENGTH & 0x03 ) ); // header length must be divisible by 4
 
+namespace {
+
+// TCP option kinds (RFC 9293 section 3.1, RFC 7323, RFC 2018)
+namespace option {
+constexpr uint8_t END = 0;
+constexpr uint8_t NOP = 1;
+constexpr uint8_t MSS = 2;
+constexpr uint8_t WINDOW_SCALE = 3;
+constexpr uint8_t SACK_PERMITTED = 4;
+constexpr uint8_t SACK = 5;
+} // namespace option
+
+constexpr uint8_t MSS_LENGTH = 4;
+constexpr uint8_t WINDOW_SCALE_LENGTH = 3;
+constexpr uint8_t SACK_PERMITTED_LENGTH = 2;
+constexpr uint8_t SACK_BLOCK_LENGTH = 8;
+constexpr uint8_t MAX_OPTIONS_LENGTH = TCPSegment::MAX_HEADER_LENGTH - TCPSegment::HEADER_LENGTH;
+
+// Each option is sent after enough no-ops to end it on a 32-bit boundary.
+constexpr uint8_t aligned( uint8_t length )
+{
+  return static_cast<uint8_t>( ( length + 3 ) & ~3U );
+}
+
+// How many of the receiver's SACK blocks fit alongside the other options (which take `other_options` bytes)?
+size_t sack_blocks_to_send( const TCPMessage& message, uint8_t other_options )
+{
+  const size_t room = MAX_OPTIONS_LENGTH - other_options;
+  if ( room < aligned( 2 ) + SACK_BLOCK_LENGTH ) {
+    return 0;
+  }
+  return min( { message.receiver->sack.size(),
+                TCPReceiverMessage::MAX_SACK_BLOCKS,
+                ( room - aligned( 2 ) ) / SACK_BLOCK_LENGTH } );
+}
+
+constexpr uint8_t sack_length( size_t blocks )
+{
+  return static_cast<uint8_t>( 2 + blocks * SACK_BLOCK_LENGTH );
+}
+
+// Length of the options serialize() writes for `message`
+uint8_t options_length( const TCPMessage& message )
+{
+  uint8_t length = 0;
+  if ( message.sender->SYN and message.sender->mss.has_value() ) {
+    length += aligned( MSS_LENGTH );
+  }
+  if ( message.sender->SYN and message.sender->window_scale.has_value() ) {
+    length += aligned( WINDOW_SCALE_LENGTH );
+  }
+  if ( message.sender->SYN and message.sender->sack_permitted ) {
+    length += aligned( SACK_PERMITTED_LENGTH );
+  }
+  const size_t blocks = sack_blocks_to_send( message, length );
+  if ( blocks > 0 ) {
+    length += aligned( sack_length( blocks ) );
+  }
+  return length;
+}
+
+// Parse the `length` bytes of options that follow the fixed header, skipping any kinds not understood here.
+void parse_options( Parser& parser, size_t length, TCPMessage& message )
+{
+  while ( length > 0 ) {
+    uint8_t kind {};
+    parser.integer( kind );
+    --length;
+    if ( kind == option::END ) {
+      break;
+    }
+    if ( kind == option::NOP ) {
+      continue;
+    }
+
+    uint8_t option_length {};
+    if ( length > 0 ) {
+      parser.integer( option_length );
+    }
+    if ( option_length < 2 or option_length - 1U > length ) {
+      parser.set_error();
+      return;
+    }
+    length -= option_length - 1U;
+    const uint8_t body_length = option_length - 2;
+
+    if ( kind == option::MSS and body_length == 2 ) {
+      uint16_t mss {};
+      parser.integer( mss );
+      message.sender->mss = mss;
+    } else if ( kind == option::WINDOW_SCALE and body_length == 1 ) {
+      uint8_t shift {};
+      parser.integer( shift );
+      message.sender->window_scale = shift;
+    } else if ( kind == option::SACK_PERMITTED and body_length == 0 ) {
+      message.sender->sack_permitted = true;
+    } else if ( kind == option::SACK and body_length % SACK_BLOCK_LENGTH == 0 ) {
+      for ( uint8_t i = 0; i < body_length; i += SACK_BLOCK_LENGTH ) {
+        uint32_t left {};
+        uint32_t right {};
+        parser.integer( left );
+        parser.integer( right );
+        message.receiver->sack.push_back( { Wrap32 { left }, Wrap32 { right } } );
+      }
+    } else {
+      parser.remove_prefix( body_length );
+    }
+
+    if ( parser.has_error() ) {
+      return;
+    }
+  }
+
+  parser.remove_prefix( length ); // anything after the end of the option list
+}
+
+} // namespace
+
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   /* verify checksum */
@@ -48,12 +168,19 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
+  // parse any options (or anything extra) in the header
   if ( data_offset < ( HEADER_LENGTH >> 2 ) ) {
     parser.set_error();
     return;
   }
-  parser.remove_prefix( data_offset * 4 - HEADER_LENGTH );
+  message.sender->mss.reset();
+  message.sender->window_scale.reset();
+  message.sender->sack_permitted = false;
+  message.receiver->sack.clear();
+  parse_options( parser, data_offset * 4 - HEADER_LENGTH, message );
+  if ( parser.has_error() ) {
+    return;
+  }
 
   parser.concatenate_all_remaining( message.sender->payload );
 }
@@ -64,13 +191,19 @@ public:
   uint32_t raw_value() const { return raw_value_; }
 };
 
+uint8_t TCPSegment::header_length() const
+{
+  return HEADER_LENGTH + options_length( message );
+}
+
 void TCPSegment::serialize( Serializer& serializer ) const
 {
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender->seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver->ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { ( HEADER_LENGTH >> 2 ) << 4 } ); // data offset
+  const uint8_t header_length = this->header_length();
+  serializer.integer( static_cast<uint8_t>( ( header_length >> 2 ) << 4 ) ); // data offset
   const bool reset = message.sender->RST or message.receiver->RST;
   const uint8_t flags = ( message.receiver->ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender->SYN ? 0b0000'0010U : 0 ) | ( message.sender->FIN ? 0b0000'0001U : 0 );
@@ -78,6 +211,41 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( message.receiver->window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+
+  // options
+  const auto option_header = [&]( uint8_t kind, uint8_t length ) {
+    for ( uint8_t i = length; i < aligned( length ); ++i ) {
+      serializer.integer( option::NOP );
+    }
+    serializer.integer( kind );
+    serializer.integer( length );
+  };
+
+  uint8_t other_options = 0;
+  if ( message.sender->SYN and message.sender->mss.has_value() ) {
+    option_header( option::MSS, MSS_LENGTH );
+    serializer.integer( *message.sender->mss );
+    other_options += aligned( MSS_LENGTH );
+  }
+  if ( message.sender->SYN and message.sender->window_scale.has_value() ) {
+    option_header( option::WINDOW_SCALE, WINDOW_SCALE_LENGTH );
+    serializer.integer( *message.sender->window_scale );
+    other_options += aligned( WINDOW_SCALE_LENGTH );
+  }
+  if ( message.sender->SYN and message.sender->sack_permitted ) {
+    option_header( option::SACK_PERMITTED, SACK_PERMITTED_LENGTH );
+    other_options += aligned( SACK_PERMITTED_LENGTH );
+  }
+
+  const size_t blocks = sack_blocks_to_send( message, other_options );
+  if ( blocks > 0 ) {
+    option_header( option::SACK, sack_length( blocks ) );
+    for ( const auto& block : span { message.receiver->sack }.first( blocks ) ) {
+      serializer.integer( Wrap32Serializable { block.left }.raw_value() );
+      serializer.integer( Wrap32Serializable { block.right }.raw_value() );
+    }
+  }
+
   serializer.buffer( message.sender->payload );
 }
 
@@ -113,6 +281,19 @@ string TCPSegment::to_string() const
   if ( ackno.has_value() ) {
     ss << " ACK<" << Wrap32Serializable { *ackno }.raw_value() << ">";
   }
+  if ( message.sender->mss.has_value() ) {
+    ss << " mss=" << *message.sender->mss;
+  }
+  if ( message.sender->window_scale.has_value() ) {
+    ss << " wscale=" << static_cast<unsigned>( *message.sender->window_scale );
+  }
+  if ( message.sender->sack_permitted ) {
+    ss << " +SACK_PERMITTED";
+  }
+  for ( const auto& block : message.receiver->sack ) {
+    ss << " SACK<" << Wrap32Serializable { block.left }.raw_value() << "-"
+       << Wrap32Serializable { block.right }.raw_value() << ">";
+  }
   ss << " winsize=" << message.receiver->window_size;
   ss << " src=" << udinfo.src_port << " dst=" << udinfo.dst_port;
   return ss.str();
@@ -27,7 +27,11 @@ struct TCPSegment
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
 
-  static constexpr uint8_t HEADER_LENGTH = 20; // TCP header length, not including options
+  static constexpr uint8_t HEADER_LENGTH = 20;     // TCP header length, not including options
+  static constexpr uint8_t MAX_HEADER_LENGTH = 60; // ... and including as many options as the header can hold
+
+  // Length of the header as serialized, including any options
+  uint8_t header_length() const;
 
   // Return a string containing a summary in human-readable format
   std::string to_string() const;
@@ -2,12 +2,14 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 /*
  * The TCPSenderMessage structure contains the information sent from a TCP sender to its receiver.
  *
- * It contains five fields:
+ * It contains five fields, plus the TCP options a sender offers on its SYN:
  *
  * 1) The sequence number (seqno) of the beginning of the segment. If the SYN flag is set, this is the
  *    sequence number of the SYN flag. Otherwise, it's the sequence number of the beginning of the payload.
@@ -20,6 +22,15 @@
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 6) The SACK-permitted option (RFC 2018). On a SYN, it says the sender understands selective acknowledgments,
+ *    so the receiver at the other end may send them.
+ *
+ * 7) The window scale option (RFC 7323). On a SYN, it offers to scale the windows this side advertises: if the
+ *    other side offers too, every window after the SYNs counts in units of 2^window_scale bytes.
+ *
+ * 8) The maximum segment size option (RFC 9293 section 3.7.1). On a SYN, the largest payload this side can
+ *    receive in one segment.
  */
 
 struct TCPSenderMessage
@@ -32,6 +43,10 @@ struct TCPSenderMessage
 
   bool RST {};
 
+  bool sack_permitted {};
+  std::optional<uint8_t> window_scale {};
+  std::optional<uint16_t> mss {};
+
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }
 };
@@ -0,0 +1,93 @@
+#include "temp_file_mapping.hh"
+
+#include "exception.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+FileDescriptor make_temp_file( size_t size )
+{
+  const char* tmpdir = getenv( "TMPDIR" ); // NOLINT(concurrency-mt-unsafe)
+  string path = string( tmpdir ? tmpdir : "/tmp" ) + "/minnow-spill-XXXXXX";
+
+  FileDescriptor fd { CheckSystemCall( "mkstemp", mkstemp( path.data() ) ) };
+  CheckSystemCall( "unlink", unlink( path.c_str() ) );
+  CheckSystemCall( "ftruncate", ftruncate( fd.fd_num(), static_cast<off_t>( size ) ) );
+  return fd;
+}
+
+char* map_file( const FileDescriptor& fd, size_t size )
+{
+  if ( size == 0 ) {
+    return nullptr;
+  }
+  void* addr = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.fd_num(), 0 );
+  if ( addr == MAP_FAILED ) { // NOLINT(*-cstyle-cast, performance-no-int-to-ptr)
+    throw unix_error { "mmap" };
+  }
+  return static_cast<char*>( addr );
+}
+
+} // namespace
+
+TempFileMapping::TempFileMapping( size_t size )
+  : fd_( make_temp_file( size ) ), size_( size ), data_( map_file( fd_, size ) )
+{
+  advise( 0, size_, MADV_SEQUENTIAL );
+}
+
+TempFileMapping::~TempFileMapping()
+{
+  if ( data_ and munmap( data_, size_ ) < 0 ) {
+    cerr << "Exception destructing TempFileMapping: munmap failed\n";
+  }
+}
+
+TempFileMapping::TempFileMapping( const TempFileMapping& other ) : TempFileMapping( other.size_ )
+{
+  if ( size_ ) {
+    memcpy( data_, other.data_, size_ );
+  }
+}
+
+TempFileMapping& TempFileMapping::operator=( const TempFileMapping& other )
+{
+  if ( this != &other ) {
+    TempFileMapping copy { other };
+    *this = move( copy );
+  }
+  return *this;
+}
+
+TempFileMapping::TempFileMapping( TempFileMapping&& other ) noexcept
+  : fd_( move( other.fd_ ) ), size_( exchange( other.size_, 0 ) ), data_( exchange( other.data_, nullptr ) )
+{}
+
+TempFileMapping& TempFileMapping::operator=( TempFileMapping&& other ) noexcept
+{
+  swap( fd_, other.fd_ );
+  swap( size_, other.size_ );
+  swap( data_, other.data_ );
+  return *this;
+}
+
+void TempFileMapping::advise( size_t offset, size_t len, int advice ) const
+{
+  if ( not data_ or len == 0 ) {
+    return;
+  }
+
+  // madvise needs a page-aligned start; widen the range down to the containing page.
+  static const size_t page_size = sysconf( _SC_PAGESIZE );
+  const size_t aligned_offset = offset - offset % page_size;
+  madvise( data_ + aligned_offset, len + ( offset - aligned_offset ), advice );
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+
+// A read/write shared memory mapping of an unnamed temporary file (in $TMPDIR, or /tmp).
+// The mapping's pages are backed by the file rather than by anonymous memory, so the kernel can write
+// them out and reclaim them under memory pressure: its size can far exceed the RAM we want to commit.
+// Copying a TempFileMapping creates a new temporary file with the same contents.
+class TempFileMapping
+{
+  FileDescriptor fd_;
+  size_t size_;
+  char* data_;
+
+public:
+  explicit TempFileMapping( size_t size );
+  ~TempFileMapping();
+
+  TempFileMapping( const TempFileMapping& other );
+  TempFileMapping& operator=( const TempFileMapping& other );
+  TempFileMapping( TempFileMapping&& other ) noexcept;
+  TempFileMapping& operator=( TempFileMapping&& other ) noexcept;
+
+  char* data() { return data_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Give the kernel a hint (see madvise(2)) about the pages covering [offset, offset + len). Failures are
+  // ignored, since the advice is only a hint.
+  void advise( size_t offset, size_t len, int advice ) const;
+};
@@ -0,0 +1,43 @@
+#include "trace.hh"
+
+#include <cstdlib>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+TraceLevel level_from_environment()
+{
+  const char* const value = getenv( "MINNOW_TRACE" ); // NOLINT(concurrency-mt-unsafe)
+  if ( value == nullptr ) {
+    return TraceLevel::Off;
+  }
+
+  const string_view name { value };
+  if ( name == "verbose" ) {
+    return TraceLevel::Verbose;
+  }
+  if ( name == "info" ) {
+    return TraceLevel::Info;
+  }
+  return TraceLevel::Off;
+}
+
+TraceLevel& current_level()
+{
+  static TraceLevel level = level_from_environment();
+  return level;
+}
+
+} // namespace
+
+TraceLevel trace_level()
+{
+  return current_level();
+}
+
+void set_trace_level( TraceLevel level )
+{
+  current_level() = level;
+}
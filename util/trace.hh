@@ -0,0 +1,44 @@
+#pragma once
+
+#include "debug.hh"
+
+#include <cstdint>
+#include <format>
+#include <string_view>
+
+// Level-gated tracing for hot paths, printed through debug().
+//
+// A trace point names its level and component: trace<TraceLevel::Verbose>( "reassembler", "stored {}", n ).
+// Points above kMaxTraceLevel are removed at compile time (everything is, when NDEBUG is defined, as in
+// minnow_optimized), so they cost nothing there. The rest print only if their level is no higher than the
+// runtime level, which is read from the MINNOW_TRACE environment variable ("info" or "verbose", off by default)
+// and can be changed with set_trace_level().
+enum class TraceLevel : uint8_t
+{
+  Off,
+  Info,    // rare events: construction, end of stream
+  Verbose, // per-segment events
+};
+
+#ifdef NDEBUG
+inline constexpr TraceLevel kMaxTraceLevel = TraceLevel::Off;
+#else
+inline constexpr TraceLevel kMaxTraceLevel = TraceLevel::Verbose;
+#endif
+
+TraceLevel trace_level();
+void set_trace_level( TraceLevel level );
+
+template<TraceLevel level, typename... Args>
+// NOLINTNEXTLINE(cppcoreguidelines-missing-std-forward)
+void trace( std::string_view component [[maybe_unused]],
+            std::format_string<Args...> fmt [[maybe_unused]],
+            Args&&... args [[maybe_unused]] )
+{
+  static_assert( level != TraceLevel::Off, "a trace point needs a level" );
+  if constexpr ( level <= kMaxTraceLevel ) {
+    if ( level <= trace_level() ) {
+      debug( "[{}] {}", component, std::format( fmt, std::forward<Args>( args )... ) );
+    }
+  }
+}
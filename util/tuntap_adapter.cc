@@ -1,11 +1,16 @@
 #include "tuntap_adapter.hh"
+#include "chunk_pool.hh"
 #include "helpers.hh"
 
 using namespace std;
 
 optional<TCPMessage> TCPOverIPv4OverTunFdAdapter::read()
 {
-  vector<string> strs( 3 );
+  vector<string> strs;
+  strs.reserve( 3 );
+  strs.push_back( ChunkPool::acquire( IPv4Header::LENGTH ) );
+  strs.push_back( ChunkPool::acquire( TCPSegment::HEADER_LENGTH ) );
+  strs.emplace_back();
   strs[0].resize( IPv4Header::LENGTH );
   strs[1].resize( TCPSegment::HEADER_LENGTH );
   _tun.read( strs );